@@ -38,6 +38,7 @@
 #include <unistd.h>
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
 
 namespace {
 
@@ -47,10 +48,17 @@ namespace {
 
   void help() {
     std::cout << "Cutlet v" << VERSION << "\n\n"
-              << "cutlet [-i path] filename ...\n"
+              << "cutlet [-i path] [-b] [-d frames] [-O level] filename ...\n"
+              << "cutlet --emit-cpp filename\n"
               << "cutlet -h\n"
               << "  --include=path  Include path to the library search\n"
               << "  -I path\n"
+              << "  --bytecode|-b   Run compiled code as bytecode\n"
+              << "  --depth=frames  Limit the stack depth, 0 for no limit\n"
+              << "  -d frames\n"
+              << "  --optimize=level\n"
+              << "  -O level        Optimization level, 0 for none\n"
+              << "  --emit-cpp      Write the scripts out as C++ source\n"
               << "  -V              Display the version\n"
               << "  --help|-h       Displays this help"
               << std::endl;
@@ -90,6 +98,10 @@ namespace {
 
   struct option longopts[] = {
     {"include", required_argument, nullptr, 'I' },
+    {"bytecode", no_argument,      nullptr, 'b' },
+    {"depth",   required_argument, nullptr, 'd' },
+    {"optimize", required_argument, nullptr, 'O' },
+    {"emit-cpp", no_argument,      nullptr, 'e' },
     {"libdir",  no_argument,       nullptr, 'L' },
     {"libs",    no_argument,       nullptr, 'l' },
     {"cflags",  no_argument,       nullptr, 'c' },
@@ -106,12 +118,26 @@ namespace {
 int main(int argc, char *argv[]) {
   cutlet::interpreter interpreter;
   std::string info;
+  bool emit_cpp = false;
 
   // Parse the command line options.
   opterr = 0;
   int opt;
-  while ((opt = getopt_long(argc, argv, "I:hV", longopts, nullptr)) != -1) {
+  while ((opt = getopt_long(argc, argv, "I:bd:O:hV", longopts,
+                            nullptr)) != -1) {
     switch (opt) {
+    case 'b': // Run the bytecode backend
+      interpreter.bytecode(true);
+      break;
+    case 'd': // Stack depth limit
+      interpreter.max_depth(std::strtoul(optarg, nullptr, 10));
+      break;
+    case 'O': // Optimization level
+      interpreter.optimize(std::strtoul(optarg, nullptr, 10));
+      break;
+    case 'e': // Write C++ rather than running the scripts
+      emit_cpp = true;
+      break;
     case 'c': // C flags
       if (not info.empty()) info += " ";
       info += "-std=c++17";
@@ -142,8 +168,13 @@ int main(int argc, char *argv[]) {
   try {
     if (optind < argc) {
       // Iterate over command lines for script files.
-      for (int i = optind; i < argc; ++i)
-        compiled = interpreter.compile_file(argv[i]);
+      for (int i = optind; i < argc; ++i) {
+        if (emit_cpp)
+          interpreter.emit_cpp(argv[i], std::cout);
+        else
+          compiled = interpreter.compile_file(argv[i]);
+      }
+      if (emit_cpp) return EXIT_SUCCESS;
 
     } else {
       // Nothing on the command line so read from stdin.
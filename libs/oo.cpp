@@ -30,7 +30,7 @@
 
 #include <cutlet>
 #include <sstream>
-#include <set>
+#include <unordered_set>
 
 namespace {
   class _def_class;
@@ -99,7 +99,7 @@ namespace {
 
   private:
     cutlet::component::pointer _class;
-    std::map<std::string, cutlet::variable::pointer> _properties;
+    cutlet::atom_map<cutlet::variable::pointer> _properties;
   };
 
   /* Class definition as a cutlet component. */
@@ -143,11 +143,11 @@ namespace {
   private:
     std::string _name;
     std::list<cutlet::component::pointer> _parents;
-    std::map<std::string, cutlet::variable::pointer> _class_properties;
-    std::set<std::string> _properties;
+    cutlet::atom_map<cutlet::variable::pointer> _class_properties;
+    std::unordered_set<cutlet::atom, cutlet::atom::hash> _properties;
 
-    std::map<std::string, cutlet::component::pointer> _class_methods;
-    std::map<std::string, cutlet::component::pointer> _methods;
+    cutlet::atom_map<cutlet::component::pointer> _class_methods;
+    cutlet::atom_map<cutlet::component::pointer> _methods;
     void *_data;
     deletefn_t _delete_fn;
 
@@ -350,7 +350,7 @@ _var_object::operator()(cutlet::component &cls,
  *****************************/
 
 bool _var_object::has_property(const std::string &name) const {
-  return (_properties.find(name) != _properties.end());
+  return (_properties.find(cutlet::atom::find(name)) != _properties.end());
 }
 
 /*************************
@@ -358,15 +358,16 @@ bool _var_object::has_property(const std::string &name) const {
  *************************/
 
 cutlet::variable::pointer _var_object::property(const std::string &name) const {
-  if (_properties.find(name) == _properties.end())
+  auto it = _properties.find(cutlet::atom::find(name));
+  if (it == _properties.end())
     throw std::runtime_error(std::string("Property ")  + name +
                              " not found in object.");
-  return _properties.at(name);
+  return it->second;
 }
 
 void _var_object::property(const std::string &name,
                            cutlet::variable::pointer value) {
-  _properties[name] = value;
+  _properties[cutlet::atom(name)] = value;
 }
 
 /*****************************************************************************
@@ -440,19 +441,27 @@ cutlet::variable::pointer _def_class::operator ()(cutlet::interpreter &interp,
     cutlet::list params(arguments.begin() + 1, arguments.end());
 
     // Find the class method.
-    auto m = _class_methods.find(method);
-    if (m == _class_methods.end()) {
+    auto key = cutlet::atom::find(method);
+    cutlet::component::pointer m;
+    auto it = _class_methods.find(key);
+    if (it != _class_methods.end()) {
+      m = it->second;
+    } else {
       // Check the parent class for the method.
       for (auto _parent_class: _parents) {
-        m = dynamic_cast<_def_class &>(*(_parent_class))._class_methods.find(method);
-        if (m != _class_methods.end()) break;
+        auto &parent = dynamic_cast<_def_class &>(*(_parent_class));
+        it = parent._class_methods.find(key);
+        if (it != parent._class_methods.end()) {
+          m = it->second;
+          break;
+        }
       }
     }
 
-    if (m != _class_methods.end()) {
+    if (m) {
       interp.push(std::make_shared<_cls_frame>(*(arguments[0]), *this));
       try {
-        (*(m->second))(interp, params);
+        (*m)(interp, params);
       } catch (...) {
         interp.pop();
         throw;
@@ -472,15 +481,17 @@ _def_class::operator ()(const std::string &method,
   /* This gets called from the object variable.
    */
 
-  auto m = _methods.find(method);
+  auto key = cutlet::atom::find(method);
+  auto m = _methods.find(key);
   if (m != _methods.end()) {
     // We found the method, now call it.
     return (*(m->second))(interp, arguments);
   } else {
     // Now check the parent class for the method.
     for (auto _parent_class: _parents) {
-      m = dynamic_cast<_def_class &>(*(_parent_class))._methods.find(method);
-      if (m != _methods.end()) {
+      auto &parent = dynamic_cast<_def_class &>(*(_parent_class));
+      m = parent._methods.find(key);
+      if (m != parent._methods.end()) {
         return (*(m->second))(interp, arguments);
       }
     }
@@ -495,7 +506,7 @@ _def_class::operator ()(const std::string &method,
  *******************/
 
 void _def_class::add(const std::string &name, cutlet::component::pointer comp) {
-  _methods[name] = comp;
+  _methods[cutlet::atom(name)] = comp;
 }
 
 /*************************
@@ -504,7 +515,7 @@ void _def_class::add(const std::string &name, cutlet::component::pointer comp) {
 
 void _def_class::add_class(const std::string &name,
                            cutlet::component::pointer comp) {
-  _class_methods[name] = comp;
+  _class_methods[cutlet::atom(name)] = comp;
 }
 
 /****************************
@@ -512,7 +523,7 @@ void _def_class::add_class(const std::string &name,
  ****************************/
 
 void _def_class::add_property(const std::string &name) {
-  _properties.insert(name);
+  _properties.insert(cutlet::atom(name));
 }
 
 /**********************************
@@ -520,7 +531,8 @@ void _def_class::add_property(const std::string &name) {
  **********************************/
 
 void _def_class::add_class_property(const std::string &name) {
-  _class_properties[name] = std::make_shared<cutlet::string>();
+  _class_properties[cutlet::atom(name)] =
+    std::make_shared<cutlet::string>();
 }
 
 /******************************
@@ -529,7 +541,7 @@ void _def_class::add_class_property(const std::string &name) {
 
 cutlet::variable::pointer
 _def_class::class_property(const std::string &name) const {
-  auto res = _class_properties.find(name);
+  auto res = _class_properties.find(cutlet::atom::find(name));
   if (res != _class_properties.end()) {
     return res->second;
   } else {
@@ -543,8 +555,9 @@ _def_class::class_property(const std::string &name) const {
 
 void _def_class::class_property(const std::string &name,
                                 cutlet::variable::pointer value) {
-  if (_class_properties.find(name) != _class_properties.end()) {
-    _class_properties[name] = value;
+  auto res = _class_properties.find(cutlet::atom::find(name));
+  if (res != _class_properties.end()) {
+    res->second = value;
   } else {
     for (auto &parent: _parents) {
       if (dynamic_cast<_def_class &>(*parent).has_class_property(name))
@@ -559,7 +572,9 @@ void _def_class::class_property(const std::string &name,
 
 bool _def_class::has_class_property(const std::string &name) const {
   // Check if we have the class property.
-  if (_class_properties.find(name) != _class_properties.end()) return true;
+  if (_class_properties.find(cutlet::atom::find(name)) !=
+      _class_properties.end())
+    return true;
 
   // We didn't have the class property, now check our parents.
   for (auto &parent: _parents) {
@@ -96,7 +96,7 @@ namespace {
 
   bool expr_condition(cutlet::interpreter &interp,
                       cutlet::variable::pointer cond) {
-    interp.push(1, *cond);
+    interp.push(1, cond);
     bool result = cutlet::primative<bool>(interp.expr(cond));
     interp.pop();
 
@@ -30,6 +30,7 @@
 
 #include "ast.h"
 #include <sstream>
+#include <typeinfo>
 
 //#define DEBUG_AST 1
 
@@ -39,11 +40,6 @@
 #endif
 
 namespace {
-  template <typename Ty>
-  constexpr bool is_type(cutlet::ast::node::pointer &ast_object) {
-    return ((dynamic_cast<Ty *>(&(*ast_object))) != nullptr);
-  }
-
   /* This class extends cutlet::string to add a pointer to the node
    */
   class value : public cutlet::string {
@@ -217,7 +213,7 @@ const parser::token &cutlet::ast::block::token() const {
  *****************************/
 
 cutlet::ast::value::value(const parser::token &token)
-  : node(), _token(token) {}
+  : node(), _token(token), _literal(cutlet::var<::value>(*this)) {}
 
 /******************************
  * cutlet::ast::value::~value *
@@ -239,7 +235,7 @@ cutlet::ast::value::operator()(cutlet::interpreter &interp) {
             << std::endl;
 #endif
 
-  return cutlet::var<::value>(*this);
+  return _literal;
 }
 
 /**************************
@@ -291,7 +287,7 @@ const parser::token &cutlet::ast::value::token() const {
  ***********************************/
 
 cutlet::ast::variable::variable(const parser::token &token)
-  : node(), _token(token) {}
+  : node(), _token(token), _slot(token) {}
 
 /************************************
  * cutlet::ast::variable::~variable *
@@ -316,7 +312,7 @@ cutlet::ast::variable::operator()(cutlet::interpreter &interp) {
               << " = " << (std::string)*interp.var((const std::string &)_token)
               << std::endl;
 #endif
-    return interp.var(static_cast<const std::string &>(_token));
+    return interp.var(static_cast<const std::string &>(_token), _slot);
   } catch (const cutlet::exception &err) {
     if (err.node() == nullptr) throw cutlet::exception(err.what(), *this);
     else throw;
@@ -373,7 +369,8 @@ const parser::token &cutlet::ast::variable::token() const {
  * cutlet::ast::command::command *
  *********************************/
 
-cutlet::ast::command::command(node::pointer n) : node(), _function(n) {}
+cutlet::ast::command::command(node::pointer n, unsigned int function_id)
+  : node(), _function(n), _function_id(function_id) {}
 
 /**********************************
  * cutlet::ast::command::~command *
@@ -387,6 +384,38 @@ cutlet::ast::command::~command() noexcept {}
 
 void cutlet::ast::command::parameter(node::pointer n) {
   _parameters.push_back(n);
+
+  // Variables are called with the operator as their first parameter.
+  if (_parameters.size() == 1 and _function_id != cutlet::A_VALUE and
+      n->id() == cutlet::A_VALUE)
+    _selector = cutlet::selector(n->body());
+
+  auto call = std::dynamic_pointer_cast<command>(n);
+  _tail = (_function_id == cutlet::A_VALUE and _parameters.size() == 1 and
+           call and call->_function_id == cutlet::A_VALUE and
+           _function->body() == "return");
+
+  // Check for the shapes we can do without making the call.
+  _shape = SHAPE_CALL;
+  auto first = _parameters.front();
+  if (_function_id == cutlet::A_VALUE) {
+    const std::string &name = _function->body();
+    if (_parameters.size() == 3 and first->id() == cutlet::A_VALUE and
+        (*std::next(_parameters.begin()))->id() == cutlet::A_VALUE and
+        (*std::next(_parameters.begin()))->body() == "=") {
+      if (name == "local") {
+        _shape = SHAPE_LOCAL;
+        _slot.name = cutlet::atom(first->body());
+      }
+      else if (name == "global") _shape = SHAPE_GLOBAL;
+    } else if (_parameters.size() == 1 and not _tail and name == "return") {
+      _shape = SHAPE_RETURN;
+    }
+  } else if (_function_id == cutlet::A_VARIABLE) {
+    if (_parameters.size() == 2 and first->id() == cutlet::A_VALUE and
+        first->body() == "append")
+      _shape = SHAPE_APPEND;
+  }
 }
 
 /************************************
@@ -395,9 +424,14 @@ void cutlet::ast::command::parameter(node::pointer n) {
 
 cutlet::variable::pointer
 cutlet::ast::command::operator()(cutlet::interpreter &interp) {
+  if (_tail) return tail_call(interp);
+
   cutlet::variable::pointer cmd = (*_function)(interp);
 
-  cutlet::list c_params;
+  if (_shape != SHAPE_CALL and fused(interp, cmd)) return nullptr;
+
+  cutlet::interpreter::arguments args(interp);
+  cutlet::list &c_params = *args;
   for (auto &parameter: _parameters) {
     c_params.push_back((*parameter)(interp));
   }
@@ -405,33 +439,33 @@ cutlet::ast::command::operator()(cutlet::interpreter &interp) {
   break_point(interp);
 
   try {
-    if (is_type<ast::variable>(_function)) {
+    if (_function_id == cutlet::A_VARIABLE) {
       // Execute the variable.
 #if defined(DEBUG_AST)
       std::clog << "AST: operator $" << body() << " -> "
                 << (std::string)*c_params[0] << std::endl;
 #endif
       if (c_params.size())
-        return (*cmd)(cmd, interp, c_params);
+        return cmd->method(cmd, interp, _selector, c_params);
       else
         return interp.call(cutlet::cast<std::string>(cmd), c_params);
 
-    } else if (is_type<ast::command>(_function)) {
+    } else if (_function_id == cutlet::A_COMMAND) {
 #if defined(DEBUG_AST)
       std::clog << "AST:" << position() << "<" << file()
                 << ">: command [" << (std::string)*cmd << "]"
                 << std::endl;
 #endif
       if (c_params.size())
-        return (*cmd)(cmd, interp, c_params);
+        return cmd->method(cmd, interp, _selector, c_params);
       else
         return interp.call(cutlet::cast<std::string>(cmd), c_params);
 
-    } else if (is_type<ast::string>(_function)) {
+    } else if (_function_id == cutlet::A_STRING) {
 #if defined(DEBUG_AST)
       std::clog << "AST: string " << (std::string)*cmd << std::endl;
 #endif
-      return (*cmd)(cmd, interp, c_params);
+      return cmd->method(cmd, interp, _selector, c_params);
 
     } else {
       // Execute the function.
@@ -440,7 +474,7 @@ cutlet::ast::command::operator()(cutlet::interpreter &interp) {
                 << ">: command " << (std::string)*cmd
                 << std::endl;
 #endif
-      return interp.call(cutlet::cast<std::string>(cmd), c_params);
+      return interp.call(cutlet::cast<std::string>(cmd), c_params, _cache);
 
     }
   } catch (const cutlet::exception &err) {
@@ -456,6 +490,96 @@ cutlet::ast::command::operator()(cutlet::interpreter &interp) {
   }
 }
 
+/***********************************
+ * cutlet::ast::command::tail_call *
+ ***********************************/
+
+cutlet::variable::pointer
+cutlet::ast::command::tail_call(cutlet::interpreter &interp) {
+  auto &call = static_cast<command &>(*_parameters.front());
+  cutlet::variable::pointer function = (*call._function)(interp);
+
+  cutlet::interpreter::arguments args(interp);
+  for (auto &parameter: call._parameters) {
+    args->push_back((*parameter)(interp));
+  }
+
+  call.break_point(interp);
+
+  try {
+    std::string name = cutlet::cast<std::string>(function);
+    if (interp._tail_call(name, *args)) {
+      break_point(interp);
+      return nullptr;
+    }
+
+    // Otherwise make the call and return its value as usual.
+    cutlet::interpreter::arguments value(interp);
+    value->push_back(interp.call(name, *args, call._cache));
+    break_point(interp);
+    return interp.call("return", *value, _cache);
+
+  } catch (const cutlet::exception &err) {
+    (void)err;
+    throw;
+  } catch (const std::exception &err) {
+    std::stringstream msg;
+    msg << file() << ":" << position() << ": " << err.what();
+    throw cutlet::exception(msg.str(), *this);
+  }
+}
+
+/*******************************
+ * cutlet::ast::command::fused *
+ *******************************/
+
+bool cutlet::ast::command::fused(cutlet::interpreter &interp,
+                                 const cutlet::variable::pointer &function) {
+  // If the name was redefined, or isn't a list, it's called as usual.
+  switch (_shape) {
+  case SHAPE_LOCAL:
+    if (not interp._bound(_function->body(), _cache, interp._builtin_local))
+      return false;
+    break;
+  case SHAPE_GLOBAL:
+    if (not interp._bound(_function->body(), _cache, interp._builtin_global))
+      return false;
+    break;
+  case SHAPE_RETURN:
+    if (not interp._bound(_function->body(), _cache, interp._return))
+      return false;
+    break;
+  case SHAPE_APPEND:
+    if (not function or typeid(*function) != typeid(cutlet::list))
+      return false;
+    break;
+  default:
+    return false;
+  }
+
+  // The parameters are still evaluated, for the debugger's break points.
+  cutlet::variable::pointer value;
+  for (auto &parameter: _parameters) value = (*parameter)(interp);
+
+  break_point(interp);
+
+  switch (_shape) {
+  case SHAPE_LOCAL:
+    interp.frame()->variable(_parameters.front()->body(), value, _slot);
+    break;
+  case SHAPE_GLOBAL:
+    interp.global(_parameters.front()->body(), value);
+    break;
+  case SHAPE_RETURN:
+    interp.frame()->done(value);
+    break;
+  default:
+    static_cast<cutlet::list &>(*function).push_back(value);
+    break;
+  }
+  return true;
+}
+
 /****************************
  * cutlet::ast::command::id *
  ****************************/
@@ -504,7 +628,9 @@ const parser::token &cutlet::ast::command::token() const {
  * cutlet::ast::expression::expression *
  ***************************************/
 
-cutlet::ast::expression::expression(node::pointer n) : node(), _function(n) {}
+cutlet::ast::expression::expression(node::pointer n,
+                                    unsigned int function_id)
+  : node(), _function(n), _function_id(function_id) {}
 
 /****************************************
  * cutlet::ast::expression::~expression *
@@ -518,6 +644,10 @@ cutlet::ast::expression::~expression() noexcept {}
 
 void cutlet::ast::expression::parameter(node::pointer n) {
   _parameters.push_back(n);
+
+  if (_parameters.size() == 1 and _function_id != cutlet::A_VALUE and
+      n->id() == cutlet::A_VALUE)
+    _selector = cutlet::selector(n->body());
 }
 
 /***************************************
@@ -528,7 +658,8 @@ cutlet::variable::pointer
 cutlet::ast::expression::operator()(cutlet::interpreter &interp) {
   cutlet::variable::pointer cmd = (*_function)(interp);
 
-  cutlet::list c_params;
+  cutlet::interpreter::arguments args(interp);
+  cutlet::list &c_params = *args;
   for (auto &parameter: _parameters) {
     c_params.push_back((*parameter)(interp));
   }
@@ -539,27 +670,27 @@ cutlet::ast::expression::operator()(cutlet::interpreter &interp) {
     if (c_params.size() == 0) {
       return cmd;
     } else {
-        if (is_type<ast::variable>(_function)) {
+        if (_function_id == cutlet::A_VARIABLE) {
           // Execute the variable.
 #if defined(DEBUG_AST)
           std::clog << "AST: expr operator $" << body() << " -> "
                     << (std::string)*c_params[0] << std::endl;
 #endif
-          return (*cmd)(cmd, interp, c_params);
+          return cmd->method(cmd, interp, _selector, c_params);
 
-        } else if (is_type<ast::command>(_function)) {
+        } else if (_function_id == cutlet::A_COMMAND) {
 #if defined(DEBUG_AST)
           std::clog << "AST:" << position() << "<" << file()
                     << ">: expr command [" << (std::string)*cmd << "]"
                     << std::endl;
 #endif
-          return (*cmd)(cmd, interp, c_params);
+          return cmd->method(cmd, interp, _selector, c_params);
 
-        } else if (is_type<ast::string>(_function)) {
+        } else if (_function_id == cutlet::A_STRING) {
 #if defined(DEBUG_AST)
           std::clog << "AST: expr string " << (std::string)*cmd << std::endl;
 #endif
-          return (*cmd)(cmd, interp, c_params);
+          return cmd->method(cmd, interp, _selector, c_params);
 
         } else {
           // Execute the function.
@@ -568,7 +699,8 @@ cutlet::ast::expression::operator()(cutlet::interpreter &interp) {
                     << ">: expr command " << (std::string)*cmd
                     << std::endl;
 #endif
-          return interp.call(cutlet::cast<std::string>(cmd), c_params);
+          return interp.call(cutlet::cast<std::string>(cmd), c_params,
+                             _cache);
         }
     }
   } catch (const cutlet::exception &err) {
@@ -660,9 +792,10 @@ void cutlet::ast::string::add(node::pointer n) {
 
 cutlet::variable::pointer
 cutlet::ast::string::operator()(cutlet::interpreter &interp) {
-  cutlet::string result;
-
   break_point(interp);
+  if (_constant) return _constant;
+
+  cutlet::string result;
 
   // Run through the string parts and put it all together.
   for (auto &part: _stringy) {
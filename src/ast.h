@@ -56,6 +56,10 @@ namespace cutlet {
 
       virtual const parser::token &token() const override;
 
+      friend class bytecode;
+      friend class optimizer;
+      friend class transpiler;
+
     private:
       std::list<node::pointer> _nodes;
     };
@@ -80,6 +84,9 @@ namespace cutlet {
 
     private:
       const parser::token _token;
+
+      // Built once and shared by every evaluation, strings are immutable.
+      cutlet::variable::pointer _literal;
     };
 
     class variable : public node {
@@ -102,11 +109,15 @@ namespace cutlet {
 
     private:
       const parser::token _token;
+      cutlet::frame::slot_cache_t _slot;
     };
 
     class command : public node {
     public:
-      command(node::pointer n);
+      /** The parser passes the A_* id of the function node, so choosing how
+       * to call it doesn't need to look at the node's type.
+       */
+      command(node::pointer n, unsigned int function_id);
       virtual ~command() noexcept override;
 
       void parameter(node::pointer n);
@@ -124,16 +135,42 @@ namespace cutlet {
 
       virtual const parser::token &token() const override;
 
+      friend class bytecode;
+      friend class optimizer;
+      friend class transpiler;
+
     private:
       node::pointer _function;
+      unsigned int _function_id;
       std::list<node::pointer> _parameters;
+      sandbox::call_cache_t _cache;
+      cutlet::selector_t _selector = cutlet::SEL_NONE;
+
+      /* Set for return [f ...], where the call to f may be left for the
+       * def function being returned from to make.
+       */
+      bool _tail = false;
+
+      /* Commands common enough to be done directly while the builtins or
+       * list they call are the ones we expect:
+       *   local name = value, global name = value, return value and
+       *   $list append value.
+       */
+      enum shape_t {SHAPE_CALL, SHAPE_LOCAL, SHAPE_GLOBAL, SHAPE_RETURN,
+        SHAPE_APPEND};
+      shape_t _shape = SHAPE_CALL;
+      cutlet::frame::slot_cache_t _slot;
+
+      cutlet::variable::pointer tail_call(cutlet::interpreter &interp);
+      bool fused(cutlet::interpreter &interp,
+                 const cutlet::variable::pointer &function);
     };
 
     class expression : public node {
     public:
       using pointer = std::shared_ptr<expression>;
 
-      expression(node::pointer n);
+      expression(node::pointer n, unsigned int function_id);
       virtual ~expression() noexcept override;
 
       void parameter(node::pointer n);
@@ -151,9 +188,16 @@ namespace cutlet {
 
       virtual const parser::token &token() const override;
 
+      friend class bytecode;
+      friend class optimizer;
+      friend class transpiler;
+
     private:
       node::pointer _function;
+      unsigned int _function_id;
       std::list<node::pointer> _parameters;
+      sandbox::call_cache_t _cache;
+      cutlet::selector_t _selector = cutlet::SEL_NONE;
     };
 
     class string : public node {
@@ -177,6 +221,10 @@ namespace cutlet {
 
       virtual const parser::token &token() const override;
 
+      friend class bytecode;
+      friend class optimizer;
+      friend class transpiler;
+
     private:
       struct _parts_s {
         std::string s;
@@ -185,6 +233,9 @@ namespace cutlet {
 
       parser::token _token;
       std::list<_parts_s> _stringy;
+
+      // Set by the optimizer when there is nothing to substitute.
+      cutlet::variable::pointer _constant;
     };
 
     class comment : public node {
@@ -0,0 +1,117 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cutlet>
+#include <mutex>
+
+/******************************************************************************
+ * class cutlet::atom
+ */
+
+namespace {
+  /* The table is a fixed set of buckets, each a chain of entries that only
+   * grows at its head. Finding an atom doesn't lock, only adding one does.
+   */
+  const size_t BUCKETS = 4096;
+
+  std::atomic<const cutlet::atom::entry_s *> _buckets[BUCKETS];
+  std::atomic<size_t> _count(0);
+  std::mutex _intern;
+
+  const cutlet::atom::entry_s *_search(const std::string &name, size_t hash) {
+    auto entry = _buckets[hash % BUCKETS].load(std::memory_order_acquire);
+    for (; entry; entry = entry->next) {
+      if (entry->hash == hash and entry->name == name) return entry;
+    }
+    return nullptr;
+  }
+
+  const std::string _empty;
+}
+
+/**********************
+ * cutlet::atom::atom *
+ **********************/
+
+cutlet::atom::atom(const std::string &name) {
+  size_t hash = std::hash<std::string>()(name);
+  _entry = _search(name, hash);
+  if (_entry) return;
+
+  std::lock_guard<std::mutex> lock(_intern);
+
+  // Someone else may have added it while we waited.
+  _entry = _search(name, hash);
+  if (_entry) return;
+
+  if (_count.load(std::memory_order_relaxed) >= capacity) {
+    _owned = std::make_shared<const entry_s>(entry_s{name, hash, nullptr});
+    _entry = _owned.get();
+    return;
+  }
+
+  _count.fetch_add(1, std::memory_order_release);
+  auto &bucket = _buckets[hash % BUCKETS];
+  _entry = new entry_s{name, hash,
+                       bucket.load(std::memory_order_relaxed)};
+  bucket.store(_entry, std::memory_order_release);
+}
+
+/**********************
+ * cutlet::atom::find *
+ **********************/
+
+cutlet::atom cutlet::atom::find(const std::string &name) {
+  size_t hash = std::hash<std::string>()(name);
+  auto entry = _search(name, hash);
+  if (entry) return atom(entry);
+
+  /* Until the table is full every atom made is interned, so a name that
+   * isn't there can't be in use.
+   */
+  if (_count.load(std::memory_order_acquire) < capacity) return atom();
+  return atom(std::make_shared<const entry_s>(entry_s{name, hash, nullptr}));
+}
+
+/**************************
+ * cutlet::atom::interned *
+ **************************/
+
+size_t cutlet::atom::interned() {
+  return _count.load(std::memory_order_relaxed);
+}
+
+/*********************
+ * cutlet::atom::str *
+ *********************/
+
+const std::string &cutlet::atom::str() const {
+  return (_entry ? _entry->name : _empty);
+}
@@ -0,0 +1,562 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "automaton.h"
+#include <bitset>
+#include <map>
+#include <algorithm>
+
+namespace {
+
+  using byteset = std::bitset<256>;
+
+  /* Thrown when a pattern uses something we can't build an automaton for.
+   */
+  struct unsupported {};
+
+  /****************************************************************************
+   * class nfa
+   */
+
+  /** A Thompson NFA built from the patterns. A state either moves to next on
+   * a byte in its set or follows its epsilon transitions.
+   */
+  class nfa {
+  public:
+    struct state_s {
+      byteset on;
+      int next = -1;
+      std::vector<int> epsilon;
+      int accept = -1;
+    };
+
+    struct fragment {
+      int start, end;
+    };
+
+    std::vector<state_s> states;
+
+    int add() {
+      states.emplace_back();
+      return static_cast<int>(states.size() - 1);
+    }
+
+    fragment bytes(const byteset &set) {
+      fragment result = {add(), add()};
+      states[result.start].on = set;
+      states[result.start].next = result.end;
+      return result;
+    }
+
+    fragment empty() {
+      fragment result = {add(), add()};
+      states[result.start].epsilon.push_back(result.end);
+      return result;
+    }
+
+    fragment concat(fragment a, fragment b) {
+      states[a.end].epsilon.push_back(b.start);
+      return {a.start, b.end};
+    }
+
+    fragment either(fragment a, fragment b) {
+      fragment result = {add(), add()};
+      states[result.start].epsilon = {a.start, b.start};
+      states[a.end].epsilon.push_back(result.end);
+      states[b.end].epsilon.push_back(result.end);
+      return result;
+    }
+
+    fragment star(fragment a) {
+      fragment result = {add(), add()};
+      states[result.start].epsilon = {a.start, result.end};
+      states[a.end].epsilon.push_back(a.start);
+      states[a.end].epsilon.push_back(result.end);
+      return result;
+    }
+
+    fragment optional(fragment a) {
+      fragment result = {add(), add()};
+      states[result.start].epsilon = {a.start, result.end};
+      states[a.end].epsilon.push_back(result.end);
+      return result;
+    }
+  };
+
+  /****************************************************************************
+   * class regex_compiler
+   */
+
+  /** A recursive decent parser for the regular subset of ECMAScript
+   * regular expressions that adds the pattern to an nfa.
+   */
+  class regex_compiler {
+  public:
+    regex_compiler(nfa &machine, const std::string &pattern)
+      : _nfa(machine), _pattern(pattern), _pos(0) {}
+
+    nfa::fragment compile() {
+      auto result = alternation();
+      if (_pos != _pattern.length()) throw unsupported();
+      return result;
+    }
+
+  private:
+    nfa &_nfa;
+    const std::string &_pattern;
+    std::size_t _pos;
+
+    bool more() const { return _pos < _pattern.length(); }
+    char peek() const { return _pattern[_pos]; }
+
+    static byteset digits() {
+      byteset result;
+      for (int ch = '0'; ch <= '9'; ++ch) result.set(ch);
+      return result;
+    }
+
+    static byteset words() {
+      byteset result = digits();
+      for (int ch = 'a'; ch <= 'z'; ++ch) result.set(ch);
+      for (int ch = 'A'; ch <= 'Z'; ++ch) result.set(ch);
+      result.set('_');
+      return result;
+    }
+
+    static byteset spaces() {
+      byteset result;
+      for (char ch: {' ', '\t', '\n', '\v', '\f', '\r'})
+        result.set(static_cast<unsigned char>(ch));
+      return result;
+    }
+
+    nfa::fragment alternation() {
+      auto result = sequence();
+      while (more() and peek() == '|') {
+        ++_pos;
+        result = _nfa.either(result, sequence());
+      }
+      return result;
+    }
+
+    nfa::fragment sequence() {
+      auto result = _nfa.empty();
+      while (more() and peek() != '|' and peek() != ')')
+        result = _nfa.concat(result, repeat());
+      return result;
+    }
+
+    unsigned int number() {
+      if (not more() or not std::isdigit(static_cast<unsigned char>(peek())))
+        throw unsupported();
+
+      unsigned int result = 0;
+      while (more() and std::isdigit(static_cast<unsigned char>(peek()))) {
+        result = result * 10 + static_cast<unsigned int>(peek() - '0');
+        if (result > 1000) throw unsupported();
+        ++_pos;
+      }
+      return result;
+    }
+
+    /** Parse the atom at offset again, to get a fresh copy of its states
+     * for counted repetitions.
+     */
+    nfa::fragment again(std::size_t offset) {
+      const auto save = _pos;
+      _pos = offset;
+      auto result = atom();
+      _pos = save;
+      return result;
+    }
+
+    nfa::fragment repeat() {
+      const auto start = _pos;
+      auto result = atom();
+
+      if (not more()) return result;
+
+      switch (peek()) {
+      case '*':
+        ++_pos;
+        result = _nfa.star(result);
+        break;
+      case '+':
+        ++_pos;
+        result = _nfa.concat(result, _nfa.star(again(start)));
+        break;
+      case '?':
+        ++_pos;
+        result = _nfa.optional(result);
+        break;
+      case '{': {
+        ++_pos;
+        const unsigned int min = number();
+        unsigned int max = min;
+        bool unbounded = false;
+        if (more() and peek() == ',') {
+          ++_pos;
+          if (more() and peek() == '}') unbounded = true;
+          else max = number();
+        }
+        if (not more() or peek() != '}' or max < min) throw unsupported();
+        ++_pos;
+
+        const auto end = _pos;
+        nfa::fragment counted = (min ? result : _nfa.empty());
+        for (unsigned int count = 1; count < min; ++count)
+          counted = _nfa.concat(counted, again(start));
+        if (unbounded) {
+          counted = _nfa.concat(counted, _nfa.star(again(start)));
+        } else {
+          for (unsigned int count = min; count < max; ++count)
+            counted = _nfa.concat(counted,
+                                  _nfa.optional(min or count ?
+                                                again(start) : result));
+        }
+        _pos = end;
+        result = counted;
+        break;
+      }
+      default:
+        return result;
+      }
+
+      // Lazy and possessive quantifiers aren't regular.
+      if (more() and (peek() == '?' or peek() == '*' or peek() == '+' or
+                      peek() == '{'))
+        throw unsupported();
+
+      return result;
+    }
+
+    /** Parse an escape sequence, the \ has already been consumed.
+     */
+    byteset escape(bool in_class) {
+      if (not more()) throw unsupported();
+      const char ch = _pattern[_pos++];
+      byteset result;
+
+      switch (ch) {
+      case 'd': return digits();
+      case 'D': return ~digits();
+      case 'w': return words();
+      case 'W': return ~words();
+      case 's': return spaces();
+      case 'S': return ~spaces();
+      case 'n': result.set('\n'); return result;
+      case 't': result.set('\t'); return result;
+      case 'r': result.set('\r'); return result;
+      case 'f': result.set('\f'); return result;
+      case 'v': result.set('\v'); return result;
+      case '0': result.set(0); return result;
+      case 'b':
+        // Backspace in a class, a word boundary assertion otherwise.
+        if (not in_class) throw unsupported();
+        result.set('\b');
+        return result;
+      case 'x': {
+        if (_pos + 2 > _pattern.length()) throw unsupported();
+        const auto value = std::stoul(_pattern.substr(_pos, 2), nullptr, 16);
+        _pos += 2;
+        result.set(value);
+        return result;
+      }
+      default:
+        // Back references, \B, \c, \u and friends.
+        if (std::isalnum(static_cast<unsigned char>(ch))) throw unsupported();
+        result.set(static_cast<unsigned char>(ch));
+        return result;
+      }
+    }
+
+    /** Parse a character class, the [ has already been consumed.
+     */
+    byteset bracket() {
+      byteset result;
+      bool negate = false;
+
+      if (more() and peek() == '^') {
+        negate = true;
+        ++_pos;
+      }
+
+      while (more() and peek() != ']') {
+        byteset item;
+        int low = -1;
+
+        if (peek() == '\\') {
+          ++_pos;
+          item = escape(true);
+          if (item.count() == 1) {
+            for (low = 0; not item.test(static_cast<std::size_t>(low)); ++low);
+          }
+        } else {
+          low = static_cast<unsigned char>(_pattern[_pos++]);
+          item.set(static_cast<std::size_t>(low));
+        }
+
+        // A range of bytes.
+        if (_pos + 1 < _pattern.length() and peek() == '-' and
+            _pattern[_pos + 1] != ']') {
+          ++_pos;
+          int high;
+          if (peek() == '\\') {
+            ++_pos;
+            byteset upper = escape(true);
+            if (upper.count() != 1) throw unsupported();
+            for (high = 0; not upper.test(static_cast<std::size_t>(high));
+                 ++high);
+          } else {
+            high = static_cast<unsigned char>(_pattern[_pos++]);
+          }
+          if (low < 0 or high < low) throw unsupported();
+          for (int ch = low; ch <= high; ++ch)
+            item.set(static_cast<std::size_t>(ch));
+        }
+
+        result |= item;
+      }
+
+      if (not more()) throw unsupported();
+      ++_pos; // Skip the ]
+
+      return (negate ? ~result : result);
+    }
+
+    nfa::fragment atom() {
+      if (not more()) throw unsupported();
+
+      const char ch = _pattern[_pos++];
+      switch (ch) {
+      case '(': {
+        if (more() and peek() == '?') {
+          // Only non-capturing groups, no look ahead.
+          if (_pos + 1 < _pattern.length() and _pattern[_pos + 1] == ':')
+            _pos += 2;
+          else
+            throw unsupported();
+        }
+        auto result = alternation();
+        if (not more() or peek() != ')') throw unsupported();
+        ++_pos;
+        return result;
+      }
+
+      case '[':
+        return _nfa.bytes(bracket());
+
+      case '.': {
+        byteset any;
+        any.set();
+        any.reset('\n');
+        any.reset('\r');
+        return _nfa.bytes(any);
+      }
+
+      case '\\':
+        return _nfa.bytes(escape(false));
+
+      case '^':
+        // Tokens are always matched from the cursor so a leading ^ is a
+        // no-op, anywhere else it's an assertion.
+        if (_pos != 1) throw unsupported();
+        return _nfa.empty();
+
+      case '$': case '*': case '+': case '?': case '{': case ')': case '|':
+        throw unsupported();
+
+      default: {
+        byteset literal;
+        literal.set(static_cast<unsigned char>(ch));
+        return _nfa.bytes(literal);
+      }
+      }
+    }
+  };
+
+  /***********
+   * closure *
+   ***********/
+
+  /** Add all the states reachable by epsilon transitions to set.
+   */
+  void closure(const nfa &machine, std::vector<int> &set) {
+    std::vector<int> work(set);
+    std::vector<bool> seen(machine.states.size(), false);
+    for (auto state: set) seen[static_cast<std::size_t>(state)] = true;
+
+    while (not work.empty()) {
+      auto state = work.back();
+      work.pop_back();
+      for (auto next: machine.states[static_cast<std::size_t>(state)].epsilon) {
+        if (not seen[static_cast<std::size_t>(next)]) {
+          seen[static_cast<std::size_t>(next)] = true;
+          set.push_back(next);
+          work.push_back(next);
+        }
+      }
+    }
+    std::sort(set.begin(), set.end());
+  }
+
+  // Give up and use std::regex if the automaton gets this big.
+  const std::size_t max_states = 4096;
+}
+
+/******************************************************************************
+ * class parser::tokenizer::automaton
+ */
+
+/*****************************************
+ * parser::tokenizer::automaton::compile *
+ *****************************************/
+
+std::shared_ptr<const parser::tokenizer::automaton>
+parser::tokenizer::automaton::compile(const std::list<token_pat_s> &patterns) {
+  if (patterns.empty()) return nullptr;
+
+  nfa machine;
+  std::vector<int> start;
+  std::vector<unsigned int> ids;
+
+  try {
+    for (auto &pattern: patterns) {
+      regex_compiler compiler(machine, pattern.source);
+      auto fragment = compiler.compile();
+      machine.states[static_cast<std::size_t>(fragment.end)].accept =
+        static_cast<int>(ids.size());
+      ids.push_back(pattern.token_id);
+      start.push_back(fragment.start);
+    }
+  } catch (unsupported &) {
+    return nullptr;
+  } catch (std::exception &) {
+    return nullptr;
+  }
+
+  auto result = std::make_shared<automaton>();
+
+  /* Group the bytes into classes that always transition together, so the
+   * table only needs a column per class rather than per byte.
+   */
+  std::map<std::vector<bool>, unsigned char> signatures;
+  for (unsigned int byte = 0; byte < 256; ++byte) {
+    std::vector<bool> signature;
+    for (auto &state: machine.states) {
+      if (state.next >= 0) signature.push_back(state.on.test(byte));
+    }
+    auto found = signatures.find(signature);
+    if (found == signatures.end()) {
+      found = signatures.emplace(signature,
+        static_cast<unsigned char>(signatures.size())).first;
+    }
+    result->_classes[byte] = found->second;
+  }
+  result->_class_count = signatures.size();
+
+  // Pick a byte to represent each class.
+  std::vector<unsigned int> representative(result->_class_count);
+  for (unsigned int byte = 256; byte-- > 0;)
+    representative[result->_classes[byte]] = byte;
+
+  // The subset construction.
+  std::map<std::vector<int>, int> dstates;
+  std::vector<std::vector<int>> pending;
+
+  closure(machine, start);
+  dstates[start] = 0;
+  pending.push_back(start);
+
+  for (std::size_t current = 0; current < pending.size(); ++current) {
+    const auto set = pending[current];
+
+    // Does this state accept? The pattern added first has priority.
+    int accept = -1;
+    for (auto state: set) {
+      int pat = machine.states[static_cast<std::size_t>(state)].accept;
+      if (pat >= 0 and (accept < 0 or pat < accept)) accept = pat;
+    }
+    result->_accepts.push_back(accept >= 0);
+    result->_ids.push_back(accept >= 0 ?
+                           ids[static_cast<std::size_t>(accept)] : 0);
+
+    for (std::size_t cls = 0; cls < result->_class_count; ++cls) {
+      std::vector<int> next;
+      for (auto state: set) {
+        auto &nstate = machine.states[static_cast<std::size_t>(state)];
+        if (nstate.next >= 0 and nstate.on.test(representative[cls]))
+          next.push_back(nstate.next);
+      }
+
+      if (next.empty()) {
+        result->_table.push_back(-1);
+        continue;
+      }
+
+      closure(machine, next);
+      auto found = dstates.find(next);
+      if (found == dstates.end()) {
+        if (pending.size() >= max_states) return nullptr;
+        found = dstates.emplace(next, static_cast<int>(pending.size())).first;
+        pending.push_back(next);
+      }
+      result->_table.push_back(found->second);
+    }
+  }
+
+  return result;
+}
+
+/***************************************
+ * parser::tokenizer::automaton::match *
+ ***************************************/
+
+std::size_t parser::tokenizer::automaton::match(const char *data,
+                                                std::size_t length,
+                                                unsigned int &id) const {
+  std::size_t result = 0;
+  int state = 0;
+
+  for (std::size_t pos = 0; pos < length; ++pos) {
+    const auto byte = static_cast<unsigned char>(data[pos]);
+    state = _table[static_cast<std::size_t>(state) * _class_count +
+                   _classes[byte]];
+    if (state < 0) break;
+
+    // Remember the longest match so far.
+    if (_accepts[static_cast<std::size_t>(state)]) {
+      result = pos + 1;
+      id = _ids[static_cast<std::size_t>(state)];
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,75 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <libcutlet/parser>
+#include <memory>
+#include <vector>
+
+#ifndef _CUTLET_AUTOMATON_H
+#define _CUTLET_AUTOMATON_H
+
+namespace parser {
+
+  /** All of a tokenizer's patterns compiled into a single deterministic
+   * automaton. Each token is then found with one pass over the code, taking
+   * the longest match. When two patterns match the same length the one
+   * added first wins.
+   *
+   * Only the regular subset of ECMAScript is supported, ie. no back
+   * references, assertions or lazy quantifiers. compile() returns nullptr
+   * for anything else and the tokenizer falls back to std::regex.
+   */
+  class tokenizer::automaton {
+  public:
+    static std::shared_ptr<const automaton>
+    compile(const std::list<token_pat_s> &patterns);
+
+    /** Match the longest token at the start of data.
+     * @param id Set to the token id of the pattern matched.
+     * @return The length of the match, 0 if nothing matched.
+     */
+    std::size_t match(const char *data, std::size_t length,
+                      unsigned int &id) const;
+
+  private:
+    // The byte classes, bytes that always transition together.
+    unsigned char _classes[256];
+    std::size_t _class_count = 0;
+
+    // state * _class_count + class gives the next state, -1 is dead.
+    std::vector<int> _table;
+
+    // The token id each state accepts, if it does.
+    std::vector<bool> _accepts;
+    std::vector<unsigned int> _ids;
+  };
+}
+
+#endif /* _CUTLET_AUTOMATON_H */
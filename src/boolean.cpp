@@ -63,15 +63,38 @@ cutlet::boolean::~boolean() noexcept {}
 cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
                                                       interpreter &interp,
                                                       const list &arguments) {
+  return _operator(self, interp, SEL_NONE, arguments, false);
+}
+
+/***************************
+ * cutlet::boolean::method *
+ ***************************/
+
+cutlet::variable::pointer cutlet::boolean::method(variable::pointer self,
+                                                  interpreter &interp,
+                                                  selector_t op,
+                                                  const list &arguments) {
+  return _operator(self, interp, op, arguments, true);
+}
+
+/******************************
+ * cutlet::boolean::_operator *
+ ******************************/
+
+cutlet::variable::pointer
+cutlet::boolean::_operator(variable::pointer self, interpreter &interp,
+                           selector_t op, const list &arguments,
+                           bool fallback) {
   (void)self;
   (void)interp;
 
   auto args = arguments.size();
   //if (args == 0) return new boolean(_value);
 
-  std::string op = *(arguments[0]);
+  if (op == SEL_NONE) op = selector(arguments);
 
-  if (op == "not") {
+  switch (op) {
+  case SEL_NOT:
     // $boolean not
     if (args != 1)
       throw std::runtime_error("Invalid number of arguments to "
@@ -81,7 +104,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "type") {
+  case SEL_TYPE:
     // $boolean type
     if (args != 1)
       throw std::runtime_error("Invalid number of arguments to "
@@ -89,7 +112,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
 
     return std::make_shared<string>("boolean");
 
-  } else if (op == "==" or op == "=") {
+  case SEL_EQUAL:
     // $boolean == other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -99,7 +122,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "<>" or op == "!=") {
+  case SEL_NOT_EQUAL:
     // $boolean <> other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -109,7 +132,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "and") {
+  case SEL_AND:
     // $boolean and other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -119,7 +142,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "nand") {
+  case SEL_NAND:
     // $boolean and other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -129,7 +152,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "or") {
+  case SEL_OR:
     // $boolean or other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -139,7 +162,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  } else if (op == "nor") {
+  case SEL_NOR:
     // $boolean or other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -149,7 +172,7 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             ? std::make_shared<boolean>(true)
             : std::make_shared<boolean>(false));
 
-  }  else if (op == "xor") {
+  case SEL_XOR:
     // $boolean xor other
     if (args != 2)
       throw std::runtime_error("Invalid number of arguments to "
@@ -160,8 +183,12 @@ cutlet::variable::pointer cutlet::boolean::operator()(variable::pointer self,
             : std::make_shared<boolean>(false));
   }
 
+  // Not one of ours, but a subclass may have added it to operator().
+  if (fallback) return (*this)(self, interp, arguments);
+
   throw std::runtime_error(std::string("Unknown operator ") +
-                           op + " for boolean variable.");
+                           static_cast<std::string>(*(arguments[0])) +
+                           " for boolean variable.");
 }
 
 /*****************************************
@@ -41,14 +41,61 @@
 
 namespace {
 
+  /* The body of a def function that was compiled to native code by
+   * cutlet --emit-cpp.
+   */
+  class _native_body : public cutlet::ast::node {
+  public:
+    _native_body(const std::string &body, builtin::native_t native)
+      : node(), _token(cutlet::T_BLOCK, body), _native(native) {}
+    virtual ~_native_body() noexcept override;
+
+    virtual cutlet::variable::pointer
+    operator()(cutlet::interpreter &interp) override {
+      _native(interp);
+      return nullptr;
+    }
+
+    virtual unsigned int id() const override { return cutlet::A_BLOCK; }
+
+    virtual std::string file() const override { return _token.file(); }
+
+    virtual std::streampos position() const override {
+      return _token.position();
+    }
+
+    virtual const std::string &body() const override {
+      return static_cast<const std::string &>(_token);
+    }
+
+    virtual const parser::token &token() const override { return _token; }
+
+  private:
+    const parser::token _token;
+    builtin::native_t _native;
+  };
+
+  _native_body::~_native_body() noexcept {}
+
   /* Internal function definition.
    */
   class _def_function : public cutlet::component {
   public:
     _def_function(const std::string &label,
                   cutlet::variable::pointer arguments,
-                  cutlet::variable::pointer body)
-      : _label(label), _arguments(arguments), _body(body) {}
+                  cutlet::variable::pointer body,
+                  cutlet::ast::node::pointer compiled = nullptr)
+      : _label(label), _arguments(arguments), _body(body),
+        _compiled(compiled) {
+      // The parameters get the first slots of the function's frames.
+      std::vector<std::string> names;
+      for (auto &parameter: cutlet::cast<cutlet::list>(_arguments)) {
+        cutlet::list *l = dynamic_cast<cutlet::list *>(&(*parameter));
+        std::string name(l ? *(l->front()) : *parameter);
+        names.push_back(name == "*args" ? "args" : name);
+      }
+      _layout = cutlet::frame::make_layout(names);
+    }
     virtual ~_def_function() noexcept override;
 
     /* Execute the function.
@@ -56,7 +103,40 @@ namespace {
     virtual cutlet::variable::pointer
     operator ()(cutlet::interpreter &interp,
                 const cutlet::list &args) override {
+      cutlet::interpreter::arguments tail_args(interp);
+      cutlet::component::pointer tail;
+      auto result = call(interp, args, tail, *tail_args);
+
+      /* Calls left by return [f ...] are made here one after another, once
+       * the frame returned from is gone, so tail calls don't nest.
+       */
+      while (tail) {
+        auto function = std::static_pointer_cast<_def_function>(tail);
+        cutlet::interpreter::arguments current(interp);
+        current->swap(*tail_args);
+        result = function->call(interp, *current, tail, *tail_args);
+      }
+
+      return result;
+    }
+
+  private:
+    std::string _label;
+    cutlet::variable::pointer _arguments;
+    cutlet::variable::pointer _body;
+    cutlet::frame::layout_t _layout;
+
+    cutlet::ast::node::pointer _compiled;
+
+    /* Runs the function once, leaving any tail call in tail and
+     * tail_args.
+     */
+    cutlet::variable::pointer call(cutlet::interpreter &interp,
+                                   const cutlet::list &args,
+                                   cutlet::component::pointer &tail,
+                                   cutlet::list &tail_args) {
       interp.push(_label); // New frame for the function.
+      interp.frame()->layout(std::atomic_load(&_layout));
 
       // Populate the arguments of the function.
       auto p_it = cutlet::cast<cutlet::list>(_arguments).begin();
@@ -117,16 +197,16 @@ namespace {
         (*_compiled)(interp);
       }
 
+      /* Keep the layout with any locals the body's code named, so the next
+       * call has slots ready for them.
+       */
+      std::atomic_store(&_layout, interp.frame()->layout());
+
+      tail = interp.tail_call(tail_args);
+
       // Clean up the stack and return a value if there was one.
       return interp.pop();
     }
-
-  private:
-    std::string _label;
-    cutlet::variable::pointer _arguments;
-    cutlet::variable::pointer _body;
-
-    cutlet::ast::node::pointer _compiled;
   };
 }
 
@@ -136,6 +216,14 @@ _def_function::~_def_function() noexcept {}
  * Cutlets Builtin Public API
  */
 
+/*******************
+ * builtin::is_def *
+ *******************/
+
+bool builtin::is_def(const cutlet::component::pointer &comp) {
+  return dynamic_cast<_def_function *>(comp.get()) != nullptr;
+}
+
 /*********************************
  * def def name ¿arguments? body *
  *********************************/
@@ -143,6 +231,13 @@ _def_function::~_def_function() noexcept {}
 cutlet::variable::pointer
 builtin::def(cutlet::interpreter &interp,
              const cutlet::list &arguments) {
+  return def_native(interp, arguments, nullptr);
+}
+
+cutlet::variable::pointer
+builtin::def_native(cutlet::interpreter &interp,
+                    const cutlet::list &arguments,
+                    native_t native) {
 
   // Make sure we have to right number of arguments.
   size_t p_count = arguments.size();
@@ -170,7 +265,11 @@ builtin::def(cutlet::interpreter &interp,
   }
 
   // Add the function to the interpreter.
-  interp.add(name, cutlet::var<_def_function>(name, def_arguments, body));
+  cutlet::ast::node::pointer compiled;
+  if (native)
+    compiled = std::make_shared<_native_body>(std::string(*body), native);
+  interp.add(name, cutlet::var<_def_function>(name, def_arguments, body,
+                                              compiled));
 
   return nullptr;
 }
@@ -212,39 +311,9 @@ builtin::import(cutlet::interpreter &interp,
     throw std::runtime_error("import called without arguments");
   }
 
-  // Get the library search paths.
-  cutlet::variable::pointer paths = interp.var("library.path");
-
-  // Iterate through our arguments.
-  for (auto &libname: arguments) {
-    bool lib_loaded = false;
-
-    // Iterate through the library paths.
-    for (auto &path: cutlet::cast<cutlet::list>(paths)) {
-      std::string dir(*path);
-
-      // If the library exists, load it.
-      if (fexists(dir + "/" + static_cast<std::string>(*libname) +
-                  ".cutlet")) {
-        interp.compile_file(dir + "/" + static_cast<std::string>(*libname) +
-                            ".cutlet");
-        lib_loaded = true;
-        break;
-      } else if (fexists(dir + "/" + static_cast<std::string>(*libname) +
-                         SOEXT)) {
-        interp.load(dir + "/" + static_cast<std::string>(*libname) + SOEXT);
-        lib_loaded = true;
-        break;
-      }
-    }
-
-    // If the library wasn't found in any of the search paths raise an error.
-    if (not lib_loaded) {
-      throw std::runtime_error("Library " +
-                               static_cast<std::string>(*libname) +
-                               " not found.");
-    }
-  }
+  // Search the library paths for each of the libraries.
+  for (auto &libname: arguments)
+    interp.import(static_cast<std::string>(*libname));
 
   // All done.
   return nullptr;
@@ -38,6 +38,15 @@ namespace builtin {
   cutlet::variable::pointer def(cutlet::interpreter &interp,
                                 const cutlet::list &parameters);
 
+  using native_t = cutlet::interpreter::native_t;
+
+  /** def with the body already compiled to native code, which is run in
+   * place of the body's script.
+   */
+  cutlet::variable::pointer def_native(cutlet::interpreter &interp,
+                                       const cutlet::list &parameters,
+                                       native_t native);
+
   cutlet::variable::pointer incl(cutlet::interpreter &interp,
                                  const cutlet::list &parameters);
 
@@ -56,6 +65,9 @@ namespace builtin {
   cutlet::variable::pointer ret(cutlet::interpreter &interp,
                                 const cutlet::list &parameters);
 
+  /** Whether a component is a function made with def. */
+  bool is_def(const cutlet::component::pointer &comp);
+
   cutlet::variable::pointer print(cutlet::interpreter &interp,
                                   const cutlet::list &parameters);
 
@@ -78,6 +90,10 @@ namespace builtin {
                cutlet::interpreter &interp,
                const cutlet::list &parameters) override;
 
+    virtual cutlet::variable::pointer
+    method(cutlet::variable::pointer self, cutlet::interpreter &interp,
+           cutlet::selector_t op, const cutlet::list &parameters) override;
+
   private:
     cutlet::sandbox::pointer _sandbox;
   };
@@ -0,0 +1,402 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bytecode.h"
+#include <memory>
+#include <sstream>
+
+namespace {
+
+  /*****************
+   * command_error *
+   *****************/
+
+  /** Give an error raised by a command the position of the command, like
+   * ast::command does.
+   */
+  [[noreturn]] void command_error(const std::exception &err,
+                                  cutlet::ast::node &node) {
+    std::stringstream msg;
+    msg << node.file() << ":" << node.position() << ": " << err.what();
+    throw cutlet::exception(msg.str(), node);
+  }
+}
+
+/******************************************************************************
+ * class cutlet::ast::bytecode
+ */
+
+/***********************************
+ * cutlet::ast::bytecode::bytecode *
+ ***********************************/
+
+cutlet::ast::bytecode::bytecode(std::shared_ptr<block> tree)
+  : node(), _tree(tree) {
+  for (auto &statement: _tree->_nodes) {
+    if (not statement) continue;
+    compile(*statement);
+
+    // Each statement in a block drops its result.
+    if (_depth) emit(OP_DISCARD);
+    emit(OP_CHECK);
+  }
+  emit(OP_END);
+}
+
+/************************************
+ * cutlet::ast::bytecode::~bytecode *
+ ************************************/
+
+cutlet::ast::bytecode::~bytecode() noexcept {}
+
+/**************************************
+ * cutlet::ast::bytecode::operator () *
+ **************************************/
+
+cutlet::variable::pointer
+cutlet::ast::bytecode::operator()(cutlet::interpreter &interp) {
+  // Most code only needs a few stack slots, so avoid the heap for those.
+  cutlet::variable::pointer small_stack[16];
+  std::unique_ptr<cutlet::variable::pointer[]> large_stack;
+  cutlet::variable::pointer *sp = small_stack;
+  if (_stack_size > 16) {
+    large_stack.reset(new cutlet::variable::pointer[_stack_size]);
+    sp = large_stack.get();
+  }
+
+  std::vector<std::string> strings(_string_depth);
+  std::string *str = strings.data();
+
+  cutlet::frame &frame = *interp.frame();
+  const instruction_s *pc = _code.data();
+
+  /* With GCC and clang each instruction jumps straight to the next one's
+   * handler, otherwise it's a plain switch in a loop. A computed goto
+   * doesn't run destructors, so handlers keep no locals of their own.
+   */
+#if defined(__GNUC__)
+  static const void *const dispatch[] = {
+    &&OP_VALUE, &&OP_VARIABLE, &&OP_NODE, &&OP_STRING, &&OP_TEXT,
+    &&OP_APPEND, &&OP_CONCAT, &&OP_COMMENT, &&OP_CALL, &&OP_EXPR,
+    &&OP_DISCARD, &&OP_CHECK, &&OP_END
+  };
+#define TARGET(op) case op: op:
+#define DISPATCH() goto *dispatch[pc->opcode]
+
+  DISPATCH();
+#else
+#define TARGET(op) case op:
+#define DISPATCH() continue
+#endif
+
+  for (;;) {
+    switch (pc->opcode) {
+    TARGET(OP_VALUE)
+      *sp++ = static_cast<value *>(_nodes[pc->operand])->
+        value::operator()(interp);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_VARIABLE)
+      *sp++ = static_cast<variable *>(_nodes[pc->operand])->
+        variable::operator()(interp);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_NODE)
+      *sp++ = (*_nodes[pc->operand])(interp);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_STRING)
+      _nodes[pc->operand]->break_point(interp);
+      (str++)->clear();
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_TEXT)
+      *(str - 1) += _text[pc->operand];
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_APPEND)
+      if (*--sp) *(str - 1) += static_cast<std::string>(**sp);
+      sp->reset();
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_CONCAT)
+      *sp++ = cutlet::var<cutlet::string>(*--str);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_COMMENT)
+      _nodes[pc->operand]->break_point(interp);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_CALL)
+    TARGET(OP_EXPR)
+      sp = call(interp, *pc, sp);
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_DISCARD)
+      (--sp)->reset();
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_CHECK)
+      if (frame.state() != frame::FS_RUNNING) return nullptr;
+      ++pc;
+      DISPATCH();
+
+    TARGET(OP_END)
+      return nullptr;
+    }
+  }
+
+#undef TARGET
+#undef DISPATCH
+}
+
+/*******************************
+ * cutlet::ast::bytecode::call *
+ *******************************/
+
+cutlet::variable::pointer *
+cutlet::ast::bytecode::call(cutlet::interpreter &interp,
+                            const instruction_s &instr,
+                            cutlet::variable::pointer *sp) {
+  // Collect the arguments and the function off the stack.
+  sp -= instr.count;
+  cutlet::interpreter::arguments args(interp);
+  cutlet::list &arguments = *args;
+  for (unsigned int index = 0; index < instr.count; ++index)
+    arguments.push_back(std::move(sp[index]));
+  auto function = std::move(*--sp);
+
+  node &cmd = *_nodes[instr.operand];
+  cmd.break_point(interp);
+
+  cutlet::selector_t op = (instr.opcode == OP_EXPR
+                           ? static_cast<expression &>(cmd)._selector
+                           : static_cast<command &>(cmd)._selector);
+
+  try {
+    if (instr.opcode == OP_EXPR) {
+      // Expressions without arguments are just their value.
+      if (arguments.empty())
+        *sp = function;
+      else if (instr.call != CALL_WORD)
+        *sp = function->method(function, interp, op, arguments);
+      else
+        *sp = interp.call(cutlet::cast<std::string>(function), arguments,
+                          static_cast<expression &>(cmd)._cache);
+
+    } else if (instr.call == CALL_STRING or
+               (instr.call != CALL_WORD and not arguments.empty())) {
+      *sp = function->method(function, interp, op, arguments);
+    } else if (instr.call != CALL_WORD) {
+      // The name comes from a variable or subcommand, so it can't be cached.
+      *sp = interp.call(cutlet::cast<std::string>(function), arguments);
+    } else {
+      *sp = interp.call(cutlet::cast<std::string>(function), arguments,
+                        static_cast<command &>(cmd)._cache);
+    }
+  } catch (const cutlet::exception &) {
+    throw;
+  } catch (const std::exception &err) {
+    command_error(err, cmd);
+  }
+
+  return sp + 1;
+}
+
+/*****************************
+ * cutlet::ast::bytecode::id *
+ *****************************/
+
+unsigned int cutlet::ast::bytecode::id() const {
+  return _tree->id();
+}
+
+/*******************************
+ * cutlet::ast::bytecode::file *
+ *******************************/
+
+std::string cutlet::ast::bytecode::file() const {
+  return _tree->file();
+}
+
+/***********************************
+ * cutlet::ast::bytecode::position *
+ ***********************************/
+
+std::streampos cutlet::ast::bytecode::position() const {
+  return _tree->position();
+}
+
+/*******************************
+ * cutlet::ast::bytecode::body *
+ *******************************/
+
+const std::string &cutlet::ast::bytecode::body() const {
+  return _tree->body();
+}
+
+/********************************
+ * cutlet::ast::bytecode::token *
+ ********************************/
+
+const parser::token &cutlet::ast::bytecode::token() const {
+  return _tree->token();
+}
+
+/*******************************
+ * cutlet::ast::bytecode::emit *
+ *******************************/
+
+void cutlet::ast::bytecode::emit(opcode_t opcode, unsigned int operand,
+                                 unsigned int count, call_t call) {
+  _code.push_back({opcode, call, operand, count});
+
+  // Keep track of how much stack the code needs.
+  switch (opcode) {
+  case OP_VALUE:
+  case OP_VARIABLE:
+  case OP_NODE:
+    ++_depth;
+    break;
+  case OP_STRING:
+    if (++_strings > _string_depth) _string_depth = _strings;
+    break;
+  case OP_APPEND:
+  case OP_DISCARD:
+    --_depth;
+    break;
+  case OP_CONCAT:
+    --_strings;
+    ++_depth;
+    break;
+  case OP_CALL:
+  case OP_EXPR:
+    _depth -= count;
+    break;
+  default:
+    break;
+  }
+  if (_depth > _stack_size) _stack_size = _depth;
+}
+
+/***********************************
+ * cutlet::ast::bytecode::add_node *
+ ***********************************/
+
+unsigned int cutlet::ast::bytecode::add_node(node &n) {
+  _nodes.push_back(&n);
+  return static_cast<unsigned int>(_nodes.size() - 1);
+}
+
+/**********************************
+ * cutlet::ast::bytecode::compile *
+ **********************************/
+
+void cutlet::ast::bytecode::compile(node &n) {
+  auto cmd = dynamic_cast<command *>(&n);
+  if (cmd and (cmd->_tail or cmd->_shape != command::SHAPE_CALL)) {
+    /* return [f ...] decides at run time how to make the call, as do the
+     * commands that may be done without one.
+     */
+    emit(OP_NODE, add_node(n));
+
+  } else if (cmd) {
+    compile_call(OP_CALL, n, *cmd->_function, cmd->_function_id,
+                 cmd->_parameters);
+
+  } else if (auto expr = dynamic_cast<expression *>(&n)) {
+    compile_call(OP_EXPR, n, *expr->_function, expr->_function_id,
+                 expr->_parameters);
+
+  } else if (auto str = dynamic_cast<string *>(&n)) {
+    if (str->_constant) {
+      // Already folded, there's nothing to build.
+      emit(OP_NODE, add_node(n));
+      return;
+    }
+
+    emit(OP_STRING, add_node(n));
+    for (auto &part: str->_stringy) {
+      if (part.n) {
+        compile(*part.n);
+        emit(OP_APPEND);
+      } else {
+        _text.push_back(part.s);
+        emit(OP_TEXT, static_cast<unsigned int>(_text.size() - 1));
+      }
+    }
+    emit(OP_CONCAT);
+
+  } else if (dynamic_cast<variable *>(&n)) {
+    emit(OP_VARIABLE, add_node(n));
+
+  } else if (dynamic_cast<value *>(&n)) {
+    emit(OP_VALUE, add_node(n));
+
+  } else if (dynamic_cast<comment *>(&n)) {
+    emit(OP_COMMENT, add_node(n));
+
+  } else {
+    // Anything else is run as it is.
+    emit(OP_NODE, add_node(n));
+  }
+}
+
+/***************************************
+ * cutlet::ast::bytecode::compile_call *
+ ***************************************/
+
+void
+cutlet::ast::bytecode::compile_call(opcode_t opcode, node &n, node &function,
+                                    unsigned int function_id,
+                                    const std::list<node::pointer> &parameters) {
+  compile(function);
+  for (auto &parameter: parameters) compile(*parameter);
+
+  call_t call = CALL_WORD;
+  switch (function_id) {
+  case cutlet::A_VARIABLE: call = CALL_VARIABLE; break;
+  case cutlet::A_COMMAND:  call = CALL_COMMAND;  break;
+  case cutlet::A_STRING:   call = CALL_STRING;   break;
+  }
+
+  emit(opcode, add_node(n), static_cast<unsigned int>(parameters.size()),
+       call);
+}
@@ -0,0 +1,119 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ast.h"
+#include <vector>
+
+#ifndef _CUTLET_BYTECODE_H
+#define _CUTLET_BYTECODE_H
+
+namespace cutlet {
+  namespace ast {
+
+    /** A compiled block lowered to bytecode and run by a dispatch loop
+     * rather than by walking the tree. The tree is kept for the debugger
+     * and error messages, every instruction that can break or fail refers
+     * back to the node it came from.
+     */
+    class bytecode : public node {
+    public:
+      bytecode(std::shared_ptr<block> tree);
+      virtual ~bytecode() noexcept override;
+
+      virtual cutlet::variable::pointer
+      operator()(cutlet::interpreter &interp) override;
+
+      virtual unsigned int id() const override;
+
+      virtual std::string file() const override;
+
+      virtual std::streampos position() const override;
+
+      virtual const std::string &body() const override;
+
+      virtual const parser::token &token() const override;
+
+    private:
+      enum opcode_t : unsigned char {
+        OP_VALUE,    // Push the literal value of a node.
+        OP_VARIABLE, // Push the value of a variable.
+        OP_NODE,     // Push the result of running any other node.
+        OP_STRING,   // Start building a string.
+        OP_TEXT,     // Append literal text to the string.
+        OP_APPEND,   // Pop a value and append it to the string.
+        OP_CONCAT,   // Push the finished string.
+        OP_COMMENT,  // Only a break point.
+        OP_CALL,     // Call a command with count arguments.
+        OP_EXPR,     // Evaluate an expression with count arguments.
+        OP_DISCARD,  // Pop and ignore the result of a command.
+        OP_CHECK,    // Stop if the frame is no longer running.
+        OP_END
+      };
+
+      // How the function part of a command is called.
+      enum call_t : unsigned char {
+        CALL_WORD, CALL_VARIABLE, CALL_COMMAND, CALL_STRING
+      };
+
+      struct instruction_s {
+        opcode_t opcode;
+        call_t call;
+        unsigned int operand; // Index into _nodes or _text.
+        unsigned int count;
+      };
+
+      std::shared_ptr<block> _tree;
+
+      std::vector<instruction_s> _code;
+      std::vector<node *> _nodes;
+      std::vector<std::string> _text;
+
+      unsigned int _depth = 0;
+      unsigned int _stack_size = 0;
+      unsigned int _strings = 0;
+      unsigned int _string_depth = 0;
+
+      void emit(opcode_t opcode, unsigned int operand = 0,
+                unsigned int count = 0, call_t call = CALL_WORD);
+      unsigned int add_node(node &n);
+
+      cutlet::variable::pointer *call(cutlet::interpreter &interp,
+                                      const instruction_s &instr,
+                                      cutlet::variable::pointer *sp);
+
+      void compile(node &n);
+      void compile_call(opcode_t opcode, node &n, node &function,
+                        unsigned int function_id,
+                        const std::list<node::pointer> &parameters);
+    };
+  }
+}
+
+#endif /* _CUTLET_BYTECODE_H */
@@ -32,14 +32,31 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <exception>
 
 #include "builtin.h"
 #include "utilities.h"
 #include "ast.h"
+#include "scanner.h"
+#include "bytecode.h"
+#include "optimizer.h"
+#include "transpiler.h"
 
 namespace {
   // Anything defined here will not have their symbols exported.
 
+  const cutlet::atom _unknown_component("¿component?");
+  const cutlet::atom _def_name("def");
+  const cutlet::atom _return_name("return");
+
+  // The most programs the compile cache grows to hold on its own.
+  const std::size_t CACHE_LIMIT = 16384;
+
   /****************************************************************************
    * class _native_lib
    */
@@ -77,6 +94,200 @@ namespace {
     nativelib_t _handle;
   };
 
+  /* The bytes the tokenizer has to stop on when scanning strings and
+   * subcommands. 0xc2 and 0xe2 start the multibyte Unicode end of line
+   * characters, the scanner stops on them so is_eol can take a closer look.
+   */
+  const cutlet::scanner::byteset dquote_bytes = {
+    '"', '\\', '\n', '\v', '\f', '\r', 0xc2, 0xe2
+  };
+  const cutlet::scanner::byteset squote_bytes = {
+    '\'', '\\', '\n', '\v', '\f', '\r', 0xc2, 0xe2
+  };
+  const cutlet::scanner::byteset subcmd_bytes = {
+    '[', ']', '{', '}', '\n', '\v', '\f', '\r', 0xc2, 0xe2
+  };
+
+  /*************
+   * is_eol_at *
+   *************/
+
+  bool is_eol_at(const std::string &code, std::string::size_type offset) {
+    return is_eol(cutlet::utf8::iterator(code, offset).view());
+  }
+
+  /**************
+   * string_end *
+   **************/
+
+  /** Find the closing quote of a string, skipping over escaped characters.
+   * @param code The code being tokenized.
+   * @param offset Where the contents of the string starts.
+   * @param quote The quote character that started the string.
+   * @return The offset of the closing quote, or of the end of line or end
+   *         of the code if the string isn't terminated.
+   */
+  std::string::size_type string_end(const std::string &code,
+                                    std::string::size_type offset,
+                                    char quote) {
+    const auto &stops = (quote == '"' ? dquote_bytes : squote_bytes);
+
+    while (offset < code.length()) {
+      auto found = cutlet::scanner::find(code.data() + offset,
+                                         code.length() - offset, stops);
+      if (found == std::string::npos) break;
+      offset += found;
+
+      if (code[offset] == quote) {
+        return offset;
+      } else if (code[offset] == '\\') {
+        // Skip an escaped quote or backslash.
+        if (offset + 1 < code.length() and
+            (code[offset + 1] == quote or code[offset + 1] == '\\'))
+          ++offset;
+      } else if (is_eol_at(code, offset)) {
+        return offset;
+      }
+      ++offset;
+    }
+
+    return code.length();
+  }
+
+  /* The bytes that can end a word, including the lead bytes of the
+   * multibyte Unicode spaces and end of lines.
+   */
+  const cutlet::scanner::byteset word_end_bytes = {
+    ' ', '\t', '\n', '\v', '\f', '\r', 0xc2, 0xe2, 0xe3
+  };
+  const cutlet::scanner::byteset eol_bytes = {
+    '\n', '\v', '\f', '\r', 0xc2, 0xe2
+  };
+
+  /* Scripts at least twice this size are split up and parsed in chunks of
+   * about this size.
+   */
+  const std::string::size_type parse_chunk_size = 256 * 1024;
+
+  /**********************
+   * command_boundaries *
+   **********************/
+
+  /** Find where to split code into chunks that can be parsed on their own.
+   * This follows the cutlet_tokenizer rules just enough to skip over
+   * strings, blocks, subcommands, comments and line continuations, so
+   * every chunk starts at the beginning of a top level command.
+   * @param code The code to split up.
+   * @param size The size of the chunks to aim for.
+   * @return The offset each chunk starts at, empty if the code can't be
+   *         split safely. The tokenizer can report those errors.
+   */
+  std::vector<std::string::size_type>
+  command_boundaries(const std::string &code, std::string::size_type size) {
+    std::vector<std::string::size_type> result = {0};
+    const char *data = code.data();
+    const auto length = code.length();
+    std::string::size_type offset = 0, next = size;
+    bool line_start = true;
+
+    while (offset < length) {
+      auto view = cutlet::utf8::iterator(code, offset).view();
+
+      if (is_eol(view)) {
+        offset += view.length();
+        line_start = true;
+        if (offset >= next and offset < length) {
+          result.push_back(offset);
+          next = offset + size;
+        }
+        continue;
+      } else if (is_space(view)) {
+        offset += view.length();
+        continue;
+      }
+
+      switch (data[offset]) {
+      case '\\':
+        // Line continuation, the tokenizer drops the next character.
+        ++offset;
+        if (offset < length)
+          offset += cutlet::utf8::iterator(code, offset).view().length();
+        continue;
+
+      case '"':
+      case '\'': {
+        auto end = string_end(code, offset + 1, data[offset]);
+        if (end >= length or data[end] != data[offset]) return {};
+        offset = end + 1;
+        break;
+      }
+
+      case '{': {
+        unsigned int depth = 1;
+        auto found = cutlet::scanner::find_block_end(data + offset + 1,
+                                                     length - offset - 1,
+                                                     depth);
+        if (found == std::string::npos) return {};
+        offset += found + 2;
+        break;
+      }
+
+      case '[': {
+        unsigned int count = 1, blocks = 0;
+        ++offset;
+        while (count) {
+          auto found = cutlet::scanner::find(data + offset, length - offset,
+                                             subcmd_bytes);
+          if (found == std::string::npos) return {};
+          offset += found;
+          if (is_eol_at(code, offset) and not blocks) return {};
+
+          switch (data[offset]) {
+          case ']': count--; break;
+          case '[': count++; break;
+          case '}': blocks--; break;
+          case '{': blocks++; break;
+          }
+          ++offset;
+        }
+        break;
+      }
+
+      case '#':
+        if (line_start) {
+          // Comments run to the end of the line.
+          while (offset < length) {
+            auto found = cutlet::scanner::find(data + offset,
+                                               length - offset, eol_bytes);
+            if (found == std::string::npos) return result;
+            offset += found;
+            if (is_eol_at(code, offset)) break;
+            ++offset;
+          }
+          break;
+        }
+        // Fall through
+
+      default:
+        // Words and variables run to the next space or end of line.
+        while (offset < length) {
+          auto found = cutlet::scanner::find(data + offset, length - offset,
+                                             word_end_bytes);
+          if (found == std::string::npos) return result;
+          offset += found;
+          view = cutlet::utf8::iterator(code, offset).view();
+          if (classify_utf8(view) & (CC_SPACE | CC_EOL)) break;
+          offset += view.length();
+        }
+        break;
+      }
+
+      line_start = false;
+    }
+
+    return result;
+  }
+
   /****************************************************************************
    * class cutlet_tokenizer
    */
@@ -85,6 +296,9 @@ namespace {
   public:
     cutlet_tokenizer() {}
 
+    // Counted for each block tokenized, while it's set.
+    std::atomic<unsigned long> *blocks = nullptr;
+
     friend std::ostream &operator <<(std::ostream &os,
                                      const cutlet_tokenizer &tks);
 
@@ -93,6 +307,35 @@ namespace {
 
   protected:
     void parse_next_token();
+
+  private:
+    /* When a block spans several lines of a stream, where we left off
+     * scanning it, relative to the cursor, and how deeply nested we were.
+     * This saves us from rescanning the whole block every time another line
+     * is read.
+     */
+    std::string::size_type _block_scan = 0;
+    unsigned int _block_depth = 0;
+  };
+
+  /* Points a tokenizer's block count at counter while it's in scope. Only
+   * the blocks in the scripts compiled are counted, not those in code run
+   * or lists read while a script runs.
+   */
+  class count_blocks {
+  public:
+    count_blocks(parser::tokenizer &tokens,
+                 std::atomic<unsigned long> *counter)
+      : _tokens(static_cast<cutlet_tokenizer &>(tokens)),
+        _saved(_tokens.blocks) {
+      _tokens.blocks = counter;
+    }
+    count_blocks(const count_blocks &) = delete;
+    ~count_blocks() noexcept { _tokens.blocks = _saved; }
+
+  private:
+    cutlet_tokenizer &_tokens;
+    std::atomic<unsigned long> *_saved;
   };
 
   /****************************************************************************
@@ -172,10 +415,9 @@ std::ostream &operator <<(std::ostream &os,
   }
 
   // Display the variables in the frame.
-  for (auto &it: frame._variables) {
-    //os << "\n  $" << it.first;
-    os << "\n  $" << it.first << " = "
-       << cutlet::cast<std::string>(it.second);
+  for (auto &name: frame.variables()) {
+    os << "\n  $" << cutlet::cast<std::string>(name) << " = "
+       << cutlet::cast<std::string>(frame.cutlet::frame::variable(*name));
   }
 
   return os;
@@ -192,7 +434,8 @@ std::ostream &operator <<(std::ostream &os,
  */
 std::ostream &operator <<(std::ostream &os, const cutlet_tokenizer &tks) {
   unsigned int size = tks.tokens.size();
-  for (const auto &token: tks.tokens) {
+  for (std::size_t index = 0; index < size; ++index) {
+    const auto &token = tks.tokens[index];
     os << "token(" << size << "): " << (unsigned int)token << " ";
     if ((unsigned int)token != 6) {
       os << static_cast<std::string>(token) << "\n";
@@ -214,21 +457,16 @@ std::ostream &operator <<(std::ostream &os, const cutlet_tokenizer &tks) {
 
 cutlet::utf8::iterator::iterator(const std::string &value)
   : _value(&value), _index(0), _length(1) {
-  // Find the length of the character and make a copy for dereferencing.
-  for (; ((*_value)[_index + _length] & 0xc0) == 0x80; ++_length) {}
-  _current = _value->substr(_index, _length);
+  _next_length();
 }
 
 cutlet::utf8::iterator::iterator(const std::string &value, size_t offset)
   : _value(&value), _index(offset), _length(1) {
-  // Find the length of the character and make a copy for dereferencing.
-  for (; ((*_value)[_index + _length] & 0xc0) == 0x80; ++_length) {}
-  _current = _value->substr(_index, _length);
+  _next_length();
 }
 
 cutlet::utf8::iterator::iterator(const iterator &other)
-  : _value(other._value), _index(other._index), _length(other._length),
-    _current(other._current) {
+  : _value(other._value), _index(other._index), _length(other._length) {
 }
 
 /**************************************
@@ -241,7 +479,6 @@ cutlet::utf8::iterator::operator =(const iterator &other) {
     _value = other._value;
     _index = other._index;
     _length = other._length;
-    _current = other._current;
   }
   return *this;
 }
@@ -251,36 +488,16 @@ cutlet::utf8::iterator::operator =(const iterator &other) {
  ***************************************/
 
 cutlet::utf8::iterator &cutlet::utf8::iterator::operator ++() {
-  // Increment the index.
-  if (_index < _value->length()) _index += _length;
-
-  // Get the length of the character and copy the character.
   if (_index < _value->length()) {
-    for (_length = 1; ((*_value)[_index + _length] & 0xc0) == 0x80;
-         ++_length) {}
-    _current = _value->substr(_index, _length);
-  } else {
-    _current.clear();
+    _index += _length;
+    _next_length();
   }
-
   return *this;
 }
 
 cutlet::utf8::iterator cutlet::utf8::iterator::operator ++(int) {
   iterator tmp(*this);
-
-  // Increment the index.
-  if (_index < _value->length()) _index += _length;
-
-  // Get the length of the character and copy it.
-  if (_index < _value->length()) {
-    for (_length = 1; ((*_value)[_index + _length] & 0xc0) == 0x80;
-         ++_length) {}
-    _current = _value->substr(_index, _length);
-  } else {
-    _current.clear();
-  }
-
+  ++(*this);
   return tmp;
 }
 
@@ -289,41 +506,55 @@ cutlet::utf8::iterator cutlet::utf8::iterator::operator ++(int) {
  ***************************************/
 
 cutlet::utf8::iterator &cutlet::utf8::iterator::operator --() {
-  if (_index > 0) {
-    const size_t tmp = _index;
-
-    // Find the first character.
-    for (--_index; ((*_value)[_index] & 0xc0) == 0x80 and _index > 0;
-         --_index);
-
-    // Get the length of the character and copy it.
-    _length = tmp - _index;
-    _current = _value->substr(_index, _length);
-  } else {
-    _current.clear();
-  }
-
+  if (_index > 0) _previous_length(_index);
   return *this;
 }
 
 cutlet::utf8::iterator cutlet::utf8::iterator::operator --(int) {
   iterator tmp(*this);
+  --(*this);
+  return tmp;
+}
 
-  if (_index > 0) {
-    const size_t tmps = _index;
+/**************************************
+ * cutlet::utf8::iterator::operator * *
+ **************************************/
 
-    // Find the first character.
-    for (--_index; ((*_value)[_index] & 0xc0) == 0x80 and _index > 0;
-         --_index) {}
+cutlet::utf8::iterator::reference cutlet::utf8::iterator::operator *() {
+  // A single UTF-8 character always fits in the short string buffer.
+  _current.assign(view());
+  return _current;
+}
 
-    // Get the length of the character and copy it.
-    _length = tmps - _index;
-    _current = _value->substr(_index, _length);
-  } else {
-    _current.clear();
-  }
+/********************************
+ * cutlet::utf8::iterator::view *
+ ********************************/
 
-  return tmp;
+std::string_view cutlet::utf8::iterator::view() const {
+  if (_index >= _value->length()) return std::string_view();
+  return std::string_view(_value->data() + _index, _length);
+}
+
+/**************************************
+ * cutlet::utf8::iterator::code_point *
+ **************************************/
+
+char32_t cutlet::utf8::iterator::code_point() const {
+  if (_index >= _value->length()) return 0;
+
+  const unsigned char *ch =
+    reinterpret_cast<const unsigned char *>(_value->data() + _index);
+
+  if (ch[0] < 0x80) return ch[0];
+
+  // Strip the length bits from the leading byte then add the continuations.
+  char32_t result;
+  if (_length == 2) result = ch[0] & 0x1f;
+  else if (_length == 3) result = ch[0] & 0x0f;
+  else result = ch[0] & 0x07;
+
+  for (size_t i = 1; i < _length; ++i) result = (result << 6) | (ch[i] & 0x3f);
+  return result;
 }
 
 /***************************************
@@ -405,6 +636,36 @@ size_t cutlet::utf8::iterator::length() const {
   return _length;
 }
 
+/****************************************
+ * cutlet::utf8::iterator::_next_length *
+ ****************************************/
+
+void cutlet::utf8::iterator::_next_length() {
+  const size_t size = _value->length();
+  if (_index >= size) return;
+
+  // ASCII characters are always a single byte, no need to look further.
+  _length = 1;
+  if (static_cast<unsigned char>((*_value)[_index]) < 0x80) return;
+
+  while (_index + _length < size and
+         ((*_value)[_index + _length] & 0xc0) == 0x80)
+    ++_length;
+}
+
+/********************************************
+ * cutlet::utf8::iterator::_previous_length *
+ ********************************************/
+
+void cutlet::utf8::iterator::_previous_length(size_t index) {
+  // Find the first byte of the previous character.
+  _index = index - 1;
+  if (static_cast<unsigned char>((*_value)[_index]) >= 0x80) {
+    while (((*_value)[_index] & 0xc0) == 0x80 and _index > 0) --_index;
+  }
+  _length = index - _index;
+}
+
 /************************
  * cutlet::utf8::substr *
  ************************/
@@ -413,7 +674,7 @@ std::string cutlet::utf8::substr(const iterator &start, const iterator &end) {
   const std::string &value = *start._value;
 
 #ifdef TESTING
-  if (value.substr(start._index, start._length) != *start)
+  if (value.substr(start._index, start._length) != start.view())
     throw std::range_error("iter values out of sync");
 #endif
 
@@ -454,11 +715,11 @@ void cutlet_tokenizer::parse_tokens() {
     // We have more code available, usually via a stream.
     do {
       // Create as many tokens as we can from the given code.
-      if ((need_more and is_more_code()) or not code.empty()) {
+      if ((need_more and is_more_code()) or remaining()) {
         parse_next_token();
       }
-    } while (need_more or not code.empty());
-  } else if (code.empty()) {
+    } while (need_more or remaining());
+  } else if (not remaining()) {
     // Add EOF token
     add_token(T_EOF, "", position);
   }
@@ -512,22 +773,24 @@ void cutlet_tokenizer::parse_tokens() {
  **************************************/
 
 void cutlet_tokenizer::parse_next_token() {
-  if (not code.empty()) {
-    cutlet::utf8::iterator it(code);
+  if (remaining()) {
+    const std::string &text = buffer();
+    cutlet::utf8::iterator it(text, cursor);
     const std::streampos start_pos = position;
+    const bool resume_block = need_more and _block_depth;
     need_more = false;
 
     // Skip any white space.
-    while (is_space(*it) and it != it.end()) {
+    while (is_space(it.view()) and it != it.end()) {
       ++it;
       position += 1;
     }
     if (it == it.end()) {
-      code.clear();
+      cursor = text.length();
       return;
     }
 
-    if ((*it).compare(0, std::string::npos, "\\") == 0) {
+    if (it.view() == "\\") {
       /* Remove the line continuation character, newline character and prevent
        * a newline token from being created.
        */
@@ -539,7 +802,7 @@ void cutlet_tokenizer::parse_next_token() {
     } else {
       // Figure out and create the next token.
 
-      switch ((*it)[0]) {
+      switch (it.view()[0]) {
 
       case '$': {
         ++it; // Remove the $ character.
@@ -548,78 +811,41 @@ void cutlet_tokenizer::parse_next_token() {
         std::string result;
 
         // Find the end of the variable name.
-        while ((not is_space(*it) and not is_eol(*it))
+        while (not (classify_utf8(it.view()) & (CC_SPACE | CC_EOL))
                and it != it.end())
           ++it;
 
         // Add the token.
-        add_token(cutlet::T_VARIABLE,
-                  cutlet::utf8::substr(start, it),
-                  position, 1);
-        break;
-      }
-
-        // String token.
-      case '"': {
-        ++it; // Remove the " character.
-
-        cutlet::utf8::iterator start(it);
-        bool ignore = false;
-
-        // Find the matching " character.
-        for (; *it != "\"" or ignore; ++it) {
-
-          // Make sure the " isn't escaped (\").
-          if (*it == "\\" and not ignore) ignore = true;
-          else ignore = false;
-
-          // Matching " not found, throw and error.
-          if (is_eol(*it) or it == it.end())
-            throw
-              parser::syntax_error("Unmatched \"",
-                                   parser::token(cutlet::T_STRING,
-                                                 cutlet::utf8::substr(start,
-                                                                      it),
-                                                 position));
-        }
-
-        // Add the token.
-        add_token(cutlet::T_STRING,
-                  cutlet::utf8::substr(start, it),
-                  position, 1);
-        ++it; // Remove trailing "
+        add_token(cutlet::T_VARIABLE, start.position(),
+                  it.position() - start.position(), position, 1);
         break;
       }
 
         // String token.
+      case '"':
       case '\'': {
-        ++it; // Remove the ' character
+        const char quote = it.view()[0];
+        ++it; // Remove the quote character.
 
         cutlet::utf8::iterator start(it);
-        bool ignore = false;
-
-        // Find the matching ' character.
-        for (; *it != "'" or ignore; ++it) {
 
-          // Make sure the ' isn't escaped (\').
-          if (*it == "\\" and not ignore) ignore = true;
-          else ignore = false;
+        // Find the matching quote character.
+        it = cutlet::utf8::iterator(text, string_end(text, it.position(),
+                                                     quote));
 
-          // Matching ' not found, throw and error.
-          if (is_eol(*it) or it == it.end())
-            throw
-              parser::syntax_error("Unmatched '",
-                                   parser::token(cutlet::T_STRING,
-                                                 cutlet::utf8::substr(start,
-                                                                      it),
-                                                 position));
-        }
+        // Matching quote not found, throw and error.
+        if (it == it.end() or it.view()[0] != quote)
+          throw
+            parser::syntax_error(std::string("Unmatched ") + quote,
+                                 parser::token(cutlet::T_STRING,
+                                               cutlet::utf8::substr(start,
+                                                                    it),
+                                               position));
 
         // Add the token.
-        add_token(cutlet::T_STRING,
-                  cutlet::utf8::substr(start, it),
-                  position, 1);
-        ++it; // Remove trailing '
+        add_token(cutlet::T_STRING, start.position(),
+                  it.position() - start.position(), position, 1);
+        ++it; // Remove trailing quote
         break;
       }
 
@@ -633,9 +859,16 @@ void cutlet_tokenizer::parse_next_token() {
 
         // Find the matching ] character.
         while (count) {
+          // Jump to the next character we're interested in.
+          auto found = cutlet::scanner::find(text.data() + it.position(),
+                                             text.length() - it.position(),
+                                             subcmd_bytes);
+          it = cutlet::utf8::iterator(text, (found == std::string::npos ?
+                                             text.length() :
+                                             it.position() + found));
 
           // Matching ] character not found, throw and error.
-          if ((is_eol(*it) and not blocks) or it == it.end())
+          if ((is_eol(it.view()) and not blocks) or it == it.end())
             throw
               parser::syntax_error("Unmatched [",
                                    parser::token(cutlet::T_SUBCMD,
@@ -643,15 +876,18 @@ void cutlet_tokenizer::parse_next_token() {
                                                                       it),
                                                  position));
 
+          switch (it.view()[0]) {
           // Keep track of subcommands within this subcommand.
-          if (*it == "]") {
+          case ']':
             count--;
             previous = it;
-          } else if (*it == "[") count++;
+            break;
+          case '[': count++; break;
 
           // Keep track of blocks within this subcommand.
-          if (*it == "}") blocks--;
-          else if (*it == "{") blocks++;
+          case '}': blocks--; break;
+          case '{': blocks++; break;
+          }
 
           ++it; // Next character please.
         }
@@ -667,56 +903,56 @@ void cutlet_tokenizer::parse_next_token() {
       case '{': {
         ++it; // Remove the { character.
 
-        //std::cout << "DEBUG: Block pos = " << position << std::endl;
-
         cutlet::utf8::iterator start(it), previous(it);
         unsigned int count = 1;
 
+        if (resume_block) {
+          // Pick up where we left off before the last line was read.
+          it = cutlet::utf8::iterator(text, cursor + _block_scan);
+          count = _block_depth;
+        }
+        _block_depth = 0;
+
         // Find the matching } character.
-        while (count) {
+        auto found = cutlet::scanner::find_block_end(
+          text.data() + it.position(), text.length() - it.position(), count);
 
+        if (found == std::string::npos) {
           // Matching } character not found, throw and error.
-          if (it == it.end()) {
-            //std::cout << "DEBUG: stream = " << (void *)stream << std::endl;
-
-            if (not stream or not *stream or stream->eof()) {
-              std::stringstream msg;
-              msg << file << ":" << position << ": Unmatched {";
-              throw
-                parser::syntax_error(msg.str(),
-                  parser::token(cutlet::T_BLOCK,
-                                cutlet::utf8::substr(start-1,
-                                                     it),
-                                position));
-            }
-
-            position = start_pos;
-            need_more = true;
-            return;
-          }
+          it = it.end();
 
-          // Keep track of blocks within this block.
-          if (*it == "}") {
-            count--;
-            previous = it;
-          } else if (*it == "{") {
-            count++;
+          if (not stream or not *stream or stream->eof()) {
+            std::stringstream msg;
+            msg << file << ":" << position << ": Unmatched {";
+            throw
+              parser::syntax_error(msg.str(),
+                parser::token(cutlet::T_BLOCK,
+                              cutlet::utf8::substr(start-1,
+                                                   it),
+                              position));
           }
 
-          ++it; // Next character please.
+          position = start_pos;
+          _block_scan = it.position() - cursor;
+          _block_depth = count;
+          need_more = true;
+          return;
         }
 
+        previous = cutlet::utf8::iterator(text, it.position() + found);
+        it = previous + 1;
+
         // Add the token.
-        add_token(cutlet::T_BLOCK,
-                  cutlet::utf8::substr(start, previous),
-                  position, 1);
+        add_token(cutlet::T_BLOCK, start.position(),
+                  previous.position() - start.position(), position, 1);
+        if (blocks) blocks->fetch_add(1, std::memory_order_relaxed);
         break;
       }
 
       default: {
         cutlet::utf8::iterator start(it);
 
-        if (is_eol(*it) or it == it.end()) {
+        if (is_eol(it.view()) or it == it.end()) {
           // Add an end of line token.
           add_token(cutlet::T_EOL, *it, position);
           ++it;
@@ -724,34 +960,31 @@ void cutlet_tokenizer::parse_next_token() {
         } else if ((tokens.empty() or
                     static_cast<unsigned int>(tokens.back()) ==
                     cutlet::T_EOL) and
-                   (*it)[0] == '#') {
+                   it.view()[0] == '#') {
           // Add a comment token.
-          cutlet::utf8::iterator startx(it);
-          while (not is_eol(*it)) ++it;
-          add_token(cutlet::T_COMMENT,
-                    cutlet::utf8::substr(startx + 1, it),
-                    position, 1);
+          cutlet::utf8::iterator startx(it + 1);
+          while (not is_eol(it.view()) and it != it.end()) ++it;
+          add_token(cutlet::T_COMMENT, startx.position(),
+                    it.position() - startx.position(), position, 1);
 
         } else {
           // Add a word token.
-          while (not is_space(*it) and not is_eol(*it) and it != it.end())
+          while (not (classify_utf8(it.view()) & (CC_SPACE | CC_EOL)) and
+                 it != it.end())
             ++it;
-          add_token(cutlet::T_WORD,
-                    cutlet::utf8::substr(start, it),
-                    position);
+          add_token(cutlet::T_WORD, start.position(),
+                    it.position() - start.position(), position);
         }
         break;
       }
       }
     }
 
-    position = start_pos + static_cast<std::streampos>(it.position());
+    position = start_pos +
+      static_cast<std::streampos>(it.position() - cursor);
 
-    // Update the remaining code.
-    if (it != it.end())
-      code = cutlet::utf8::substr(it, it.end());
-    else
-      code.clear();
+    // Move the cursor past the code we've consumed.
+    cursor = it.position();
   }
 }
 
@@ -773,6 +1006,65 @@ std::string cutlet::component::documentation() const {
   return "";
 }
 
+/******************************************************************************
+ * Selectors
+ */
+
+namespace {
+  // The names of the builtin selectors, by selector.
+  const char *_builtin_selectors[] = {
+    "", "==", "<>", "<", "<=", ">", ">=", "+", "and", "append", "clear",
+    "endswith", "eval", "expr", "extend", "find", "foreach", "global",
+    "index", "insert", "join", "length", "link", "nand", "nor", "not", "or",
+    "prepend", "remove", "reverse", "shuffle", "size", "sort", "startswith",
+    "substr", "type", "unique", "unlink", "xor"
+  };
+
+  struct _selectors_s {
+    std::mutex mtx;
+    std::unordered_map<std::string, cutlet::selector_t> ids;
+    cutlet::selector_t next = cutlet::SEL_XOR + 1;
+
+    _selectors_s() {
+      cutlet::selector_t id = 0;
+      for (auto name: _builtin_selectors) ids.emplace(name, id++);
+      ids.erase("");
+      ids.emplace("=", cutlet::SEL_EQUAL);
+      ids.emplace("!=", cutlet::SEL_NOT_EQUAL);
+    }
+  };
+
+  _selectors_s &_selectors() {
+    static _selectors_s selectors;
+    return selectors;
+  }
+}
+
+/********************
+ * cutlet::selector *
+ ********************/
+
+cutlet::selector_t cutlet::selector(const std::string &name) {
+  auto &selectors = _selectors();
+  std::lock_guard<std::mutex> lock(selectors.mtx);
+
+  auto it = selectors.ids.find(name);
+  if (it != selectors.ids.end()) return it->second;
+
+  selectors.ids.emplace(name, selectors.next);
+  return selectors.next++;
+}
+
+cutlet::selector_t cutlet::selector(const list &arguments) {
+  if (arguments.empty() or not arguments.front()) return SEL_NONE;
+
+  auto &selectors = _selectors();
+  std::lock_guard<std::mutex> lock(selectors.mtx);
+
+  auto it = selectors.ids.find(*arguments.front());
+  return (it != selectors.ids.end() ? it->second : SEL_NONE);
+}
+
 /******************************************************************************
  * class cutlet::variable
  */
@@ -794,6 +1086,17 @@ cutlet::variable::operator()(variable::pointer self, interpreter &interp,
   return interp.call(static_cast<std::string>(*this), arguments);
 }
 
+/*****************************
+ * cutlet::variable::method *
+ *****************************/
+
+cutlet::variable::pointer
+cutlet::variable::method(pointer self, interpreter &interp, selector_t op,
+                         const list &arguments) {
+  (void)op;
+  return (*this)(self, interp, arguments);
+}
+
 /******************************************
  * cutlet::variable::operator std::string *
  ******************************************/
@@ -887,8 +1190,10 @@ cutlet::sandbox::sandbox() {}
  *****************************/
 
 cutlet::sandbox::~sandbox() noexcept {
+  ++_generation;
   _variables.clear();
   _components.clear();
+  _names.clear();
   for (auto &item: _native_libs) {
     delete reinterpret_cast<_native_lib *>(item);
   }
@@ -900,11 +1205,13 @@ cutlet::sandbox::~sandbox() noexcept {
 
 void cutlet::sandbox::add(const std::string &name, function_t func,
                           const std::string &doc) {
-  _components[name] = std::make_shared<_function>(name, func, doc);
+  add(name, std::make_shared<_function>(name, func, doc));
 }
 
 void cutlet::sandbox::add(const std::string &name, component::pointer comp) {
-  _components[name] = comp;
+  _components[atom(name)] = comp;
+  _names[name] = comp;
+  ++_generation;
 }
 
 /***************************
@@ -912,7 +1219,9 @@ void cutlet::sandbox::add(const std::string &name, component::pointer comp) {
  ***************************/
 
 void cutlet::sandbox::remove(const std::string &name) {
-  _components.erase(name);
+  _components.erase(atom::find(name));
+  _names.erase(name);
+  ++_generation;
 }
 
 /**************************
@@ -922,6 +1231,8 @@ void cutlet::sandbox::remove(const std::string &name) {
 void cutlet::sandbox::clear() {
   _variables.clear();
   _components.clear();
+  _names.clear();
+  ++_generation;
 }
 
 /************************
@@ -930,7 +1241,7 @@ void cutlet::sandbox::clear() {
 
 cutlet::component::pointer
 cutlet::sandbox::get(const std::string &name) const {
-  return _components.at(name);
+  return _components.at(atom::find(name));
 }
 
 /*****************************
@@ -939,8 +1250,9 @@ cutlet::sandbox::get(const std::string &name) const {
 
 cutlet::variable::pointer cutlet::sandbox::variable(interpreter &interp,
                                                     const std::string &name) {
-  if (_variables.find(name) != _variables.end())
-    return _variables[name];
+  auto it = _variables.find(atom::find(name));
+  if (it != _variables.end())
+    return it->second;
   else {
     try {
       list arguments({std::make_shared<cutlet::string>(name)});
@@ -952,12 +1264,19 @@ cutlet::variable::pointer cutlet::sandbox::variable(interpreter &interp,
   return nullptr;
 }
 
+cutlet::variable::pointer cutlet::sandbox::variable(interpreter &interp,
+                                                    const atom &name) {
+  auto it = _variables.find(name);
+  if (it != _variables.end()) return it->second;
+  return variable(interp, name.str());
+}
+
 void cutlet::sandbox::variable(const std::string &name,
                                variable::pointer value) {
   if (not value)
-    _variables.erase(name);
+    _variables.erase(atom::find(name));
   else
-    _variables[name] = value;
+    _variables[atom(name)] = value;
 }
 
 /*********************************
@@ -965,7 +1284,7 @@ void cutlet::sandbox::variable(const std::string &name,
  *********************************/
 
 bool cutlet::sandbox::has_variable(const std::string &name) {
-  return (_variables.find(name) != _variables.end());
+  return (_variables.find(atom::find(name)) != _variables.end());
 }
 
 /*************************
@@ -976,7 +1295,7 @@ cutlet::variable::pointer
 cutlet::sandbox::call(interpreter &interp,
                       const std::string &name,
                       const list &arguments) {
-  auto it = _components.find(name);
+  auto it = _components.find(atom::find(name));
 
   if (it != _components.end()) {
     // Execute the found component.
@@ -987,7 +1306,7 @@ cutlet::sandbox::call(interpreter &interp,
     /* We couldn't find the component, so now look for the component
      * ¿component? and execute it.
      */
-    it = _components.find("¿component?");
+    it = _components.find(_unknown_component);
     if (it != _components.end()) {
       cutlet::list args(arguments);
       args.push_front(std::make_shared<cutlet::string>(name));
@@ -998,6 +1317,56 @@ cutlet::sandbox::call(interpreter &interp,
   }
 }
 
+cutlet::variable::pointer
+cutlet::sandbox::call(interpreter &interp,
+                      const std::string &name,
+                      const list &arguments,
+                      call_cache_t &cache) {
+  // Hold on to the component in case it removes itself.
+  bool unknown = false;
+  auto comp = resolve(name, cache, &unknown);
+  if (not comp)
+    throw std::runtime_error("Unresolved component \"" + name + "\"");
+
+  if (unknown) {
+    cutlet::list args(arguments);
+    args.push_front(std::make_shared<cutlet::string>(name));
+    return (*comp)(interp, args);
+  }
+  return (*comp)(interp, arguments);
+}
+
+/****************************
+ * cutlet::sandbox::resolve *
+ ****************************/
+
+cutlet::component::pointer
+cutlet::sandbox::resolve(const std::string &name, call_cache_t &cache,
+                         bool *unknown) {
+  auto entry = std::atomic_load(&cache.entry);
+  unsigned int generation = _generation;
+
+  if (not entry or entry->generation != generation or entry->owner != this) {
+    // Resolve the component the same way the uncached call does.
+    auto it = _components.find(atom::find(name));
+    bool missing = (it == _components.end());
+    if (missing) {
+      it = _components.find(_unknown_component);
+      if (it == _components.end()) return nullptr;
+    }
+
+    entry = std::make_shared<const call_cache_t::entry_s>(
+      call_cache_t::entry_s{generation, this, it, missing});
+    std::atomic_store(&cache.entry, entry);
+    _cache_misses.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    _cache_hits.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (unknown) *unknown = entry->unknown;
+  return entry->comp->second;
+}
+
 /***************************
  * cutlet::sandbox::symbol *
  ***************************/
@@ -1049,14 +1418,23 @@ void cutlet::sandbox::load(interpreter &interp,
 
 cutlet::interpreter::interpreter() {
   tokens = new cutlet_tokenizer;
+#ifdef DEBUG
+  _optimize = 0;
+#else
+  _optimize = 1;
+#endif
   _global = std::make_shared<sandbox>();
   _global->add("print", ::builtin::print);
   _global->add("global", ::builtin::global);
+  _builtin_global = _global->get("global");
   _global->add("local", ::builtin::local);
+  _builtin_local = _global->get("local");
   _global->add("uplevel", ::builtin::uplevel);
   _global->add("def", ::builtin::def,
                "def name ¿arguments? body\n");
+  _def = _global->get("def");
   _global->add("return", ::builtin::ret);
+  _return = _global->get("return");
   _global->add("list", ::builtin::list);
   _global->add("include", ::builtin::incl);
   _global->add("import", ::builtin::import);
@@ -1099,9 +1477,11 @@ cutlet::interpreter::~interpreter() noexcept {
    * collector. This way when we run the collector nothing gets missed.
    */
   delete tokens;
+  _cache_index.clear();
+  _cache.clear();
+  _compiled.reset();
   _frame.reset();
   _global.reset();
-  _compiled.reset();
 
   _interpreters--;
 }
@@ -1127,11 +1507,28 @@ cutlet::variable::pointer cutlet::interpreter::var(const std::string &name) {
   return result;
 }
 
+cutlet::variable::pointer
+cutlet::interpreter::var(const std::string &name,
+                         cutlet::frame::slot_cache_t &cache) {
+  // The same as above, but locals in slots are found through the cache.
+  variable::pointer result = _frame->variable(name, cache);
+
+  if (not result)
+    result = _global->variable(*this, cache.intern(name));
+
+  if (not result)
+    throw std::runtime_error(std::string("Unable to resolve variable $") +
+                             name);
+
+  return result;
+}
+
 /*****************************
  * cutlet::interpreter::list *
  *****************************/
 
 cutlet::variable::pointer cutlet::interpreter::list(const std::string value) {
+  count_blocks uncounted(*tokens, nullptr);
   tokens->push(parser::token(cutlet::T_BLOCK, value));
 
   auto result = std::make_shared<cutlet::list>();
@@ -1152,11 +1549,10 @@ cutlet::variable::pointer cutlet::interpreter::list(const std::string value) {
 cutlet::variable::pointer
 cutlet::interpreter::list(const variable::pointer value) {
   const parser::token *t = value->token();
-  if (t) {
-    tokens->push(*t);
-  } else {
-    return list(cutlet::cast<std::string>(value));
-  }
+  if (not t) return list(cutlet::cast<std::string>(value));
+
+  count_blocks uncounted(*tokens, nullptr);
+  tokens->push(*t);
 
   auto result = std::make_shared<cutlet::list>();
   while (*tokens and not tokens->expect(cutlet_tokenizer::T_EOF)) {
@@ -1179,33 +1575,37 @@ cutlet::interpreter::list(const variable::pointer value) {
 
 cutlet::ast::node::pointer
 cutlet::interpreter::operator()(variable::pointer code) {
-  auto _isave = _interactive;
-  _interactive = false;
+  ast::node::pointer program;
 
   const parser::token *t = code->token();
   if (t) {
-    parser::grammer::eval(*t);
+    program = _cached_compile(*t, false, [&]() {
+      return _compile([&]() { parser::grammer::eval(*t); });
+    });
   } else {
-    parser::grammer::eval(static_cast<std::string>(*code));
+    program = _cached_compile(std::string(*code), false, [&](auto source) {
+      return _compile([&]() { parser::grammer::eval(source, "<string>"); });
+    });
   }
 
-  _frame->_compiled = _compiled;
-
-  _interactive = _isave;
+  _compiled = program;
+  _frame->_compiled = program;
+  (*program)(*this);
 
-  return _compiled;
+  return program;
 }
 
 cutlet::ast::node::pointer
 cutlet::interpreter::operator()(const std::string &code) {
-  auto _isave = _interactive;
-  _interactive = false;
-  parser::grammer::eval(code);
-  _interactive = _isave;
+  auto program = _cached_compile(code, false, [&](auto source) {
+    return _compile([&]() { parser::grammer::eval(source, "<string>"); });
+  });
 
-  _frame->_compiled = _compiled;
+  _compiled = program;
+  _frame->_compiled = program;
+  (*program)(*this);
 
-  return _compiled;
+  return program;
 }
 
 cutlet::ast::node::pointer
@@ -1214,33 +1614,260 @@ cutlet::interpreter::operator()(std::istream &in, const std::string &source,
   auto _isave = _interactive;
   _interactive = interactive;
 
-  parser::grammer::eval(in, source);
+  {
+    count_blocks counted(*tokens, &_blocks);
+    parser::grammer::eval(in, source);
+  }
   _frame->_compiled = _compiled;
+  _cache_grow();
 
   _interactive = _isave;
 
   return _compiled;
 }
 
+/********************************
+ * cutlet::interpreter::compile *
+ ********************************/
+
+cutlet::ast::node::pointer
+cutlet::interpreter::compile(const std::string &code,
+                             const std::string &source) {
+  auto program = _parse_chunks(code, source, _parse_threads);
+  if (program) {
+    ast::optimizer optimize(_optimize);
+    optimize(*std::static_pointer_cast<ast::block>(program));
+    if (_bytecode)
+      program = std::make_shared<ast::bytecode>(
+        std::static_pointer_cast<ast::block>(program));
+  } else {
+    count_blocks counted(*tokens, &_blocks);
+    program = _compile([&]() { parser::grammer::eval(code, source); });
+  }
+
+  _cache_grow();
+  return program;
+}
+
+cutlet::ast::node::pointer
+cutlet::interpreter::compile(std::istream &in, const std::string &source) {
+  ast::node::pointer program;
+  {
+    count_blocks counted(*tokens, &_blocks);
+    program = _compile([&]() { parser::grammer::eval(in, source); });
+  }
+  _cache_grow();
+  return program;
+}
+
+cutlet::ast::node::pointer
+cutlet::interpreter::_compile(const std::function<void()> &parse) {
+  auto _isave = _interactive;
+  auto _rsave = _run;
+  auto compiled = _compiled;
+  _interactive = false;
+  _run = false;
+
+  try {
+    parse();
+  } catch (...) {
+    _interactive = _isave;
+    _run = _rsave;
+    _compiled = compiled;
+    throw;
+  }
+
+  auto program = _compiled;
+  _interactive = _isave;
+  _run = _rsave;
+  _compiled = compiled;
+
+  return program;
+}
+
+cutlet::ast::node::pointer
+cutlet::interpreter::_cached_compile(
+  const parser::token &code, bool expression,
+  const std::function<ast::node::pointer()> &compile) {
+  if (_cache_size == 0) return compile();
+
+  const auto &source = code.buffer();
+  const std::size_t hash =
+    std::hash<const void *>()(source.get()) * 2 + expression;
+
+  auto program = _cache_find(hash, [&](const _cached_s &entry) {
+    return (entry.source == source and not entry.text and
+            entry.expression == expression);
+  });
+  if (program) return program;
+
+  {
+    count_blocks uncounted(*tokens, nullptr);
+    program = compile();
+  }
+  _cache_add(hash, source, false, expression, program);
+  return program;
+}
+
+cutlet::ast::node::pointer
+cutlet::interpreter::_cached_compile(
+  const std::string &code, bool expression,
+  const std::function<ast::node::pointer(
+    std::shared_ptr<const std::string>)> &compile) {
+  if (_cache_size == 0)
+    return compile(std::make_shared<const std::string>(code));
+
+  const std::size_t hash = std::hash<std::string>()(code) * 2 + expression;
+
+  auto program = _cache_find(hash, [&](const _cached_s &entry) {
+    return (entry.text and entry.expression == expression and
+            *entry.source == code);
+  });
+  if (program) return program;
+
+  auto source = std::make_shared<const std::string>(code);
+  {
+    count_blocks uncounted(*tokens, nullptr);
+    program = compile(source);
+  }
+  _cache_add(hash, source, true, expression, program);
+  return program;
+}
+
+template <class Match>
+cutlet::ast::node::pointer
+cutlet::interpreter::_cache_find(std::size_t hash, Match match) {
+  auto range = _cache_index.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (match(*it->second)) {
+      // Move it to the front of the list.
+      _cache.splice(_cache.begin(), _cache, it->second);
+      ++_cache_hits;
+      return it->second->program;
+    }
+  }
+
+  ++_cache_misses;
+  return nullptr;
+}
+
+void cutlet::interpreter::_cache_add(std::size_t hash,
+                                     std::shared_ptr<const std::string> source,
+                                     bool text, bool expression,
+                                     ast::node::pointer program) {
+  _cache.push_front({hash, std::move(source), text, expression,
+                     std::move(program)});
+  _cache_index.emplace(hash, _cache.begin());
+  _cache_grow();
+  _cache_trim();
+}
+
+/**************************************
+ * cutlet::interpreter::compile_cache *
+ **************************************/
+
+void cutlet::interpreter::compile_cache(std::size_t size) {
+  _cache_size = size;
+  _cache_fixed = true;
+  _cache_trim();
+}
+
+/************************************
+ * cutlet::interpreter::_cache_trim *
+ ************************************/
+
+void cutlet::interpreter::_cache_trim() {
+  // Drop the least recently used programs.
+  while (_cache.size() > _cache_size) {
+    auto last = std::prev(_cache.end());
+    auto range = _cache_index.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == last) {
+        _cache_index.erase(it);
+        break;
+      }
+    }
+    _cache.pop_back();
+  }
+}
+
+/************************************
+ * cutlet::interpreter::_cache_grow *
+ ************************************/
+
+void cutlet::interpreter::_cache_grow() {
+  /* Any block in the script just parsed may be run as code, so unless
+   * its size was set the cache grows to have room for them. Compiling the
+   * same script again doesn't grow it any further.
+   */
+  const unsigned long blocks = _blocks.exchange(0);
+  if (not _cache_fixed and blocks > _cache_size)
+    _cache_size = std::min<std::size_t>(blocks, CACHE_LIMIT);
+}
+
 /*************************************
  * cutlet::interpreter::compile_file *
  *************************************/
 
 cutlet::ast::node::pointer
 cutlet::interpreter::compile_file(const std::string &filename) {
-  auto _isave = _interactive;
-  _interactive = false;
+  ast::node::pointer program;
 
-  std::ifstream input_file(filename);
-  parser::grammer::eval(input_file, filename);
-  input_file.close();
+  std::string code;
+  if (load_file(filename, code)) {
+    // Make sure the last line is terminated like it would be when streamed.
+    if (not code.empty() and code.back() != '\n') code += '\n';
+    program = compile(code, filename);
 
-  _frame->_compiled = _compiled;
-  (*_compiled)(*this);
+  } else {
+    std::ifstream input_file(filename);
+    if (not input_file)
+      throw std::runtime_error("Unable to read " + filename);
+    program = compile(input_file, filename);
+    input_file.close();
+  }
 
-  _interactive = _isave;
+  _compiled = program;
+  _frame->_compiled = program;
+  (*program)(*this);
 
-  return _compiled;
+  return program;
+}
+
+/*********************************
+ * cutlet::interpreter::emit_cpp *
+ *********************************/
+
+void cutlet::interpreter::emit_cpp(const std::string &filename,
+                                   std::ostream &out) {
+  // The transpiler works from the syntax tree, not bytecode.
+  auto _bsave = _bytecode;
+  _bytecode = false;
+
+  try {
+    ast::node::pointer program;
+    std::string code;
+    if (load_file(filename, code)) {
+      if (not code.empty() and code.back() != '\n') code += '\n';
+      program = compile(code, filename);
+    } else {
+      std::ifstream input_file(filename);
+      if (not input_file)
+        throw std::runtime_error("Unable to read " + filename);
+      program = compile(input_file, filename);
+    }
+
+    ast::transpiler emit(out, [this](const parser::token &body) {
+      return std::static_pointer_cast<ast::block>(
+        _compile([&]() { parser::grammer::eval(body); }));
+    });
+    emit(*std::static_pointer_cast<ast::block>(program), filename);
+
+  } catch (...) {
+    _bytecode = _bsave;
+    throw;
+  }
+  _bytecode = _bsave;
 }
 
 /*****************************
@@ -1248,14 +1875,19 @@ cutlet::interpreter::compile_file(const std::string &filename) {
  *****************************/
 
 cutlet::variable::pointer cutlet::interpreter::expr(variable::pointer cmd) {
+  ast::node::pointer result;
+
   const parser::token *t = cmd->token();
   if (t) {
-    tokens->push(*t);
+    result = _cached_compile(*t, true, [&]() {
+      tokens->push(*t);
+      auto compiled = _expression(*tokens);
+      tokens->pop();
+      return compiled;
+    });
   } else {
-    tokens->push(static_cast<std::string>(*cmd));
+    result = _compile_expr(static_cast<std::string>(*cmd));
   }
-  ast::node::pointer result = _expression();
-  tokens->pop();
 
   if (not result) {
     return nullptr;
@@ -1265,10 +1897,40 @@ cutlet::variable::pointer cutlet::interpreter::expr(variable::pointer cmd) {
 }
 
 cutlet::variable::pointer cutlet::interpreter::expr(const std::string &cmd) {
-  tokens->push(cmd);
-  ast::node::pointer result = _expression();
-  tokens->pop();
-  return (*result)(*this);
+  return (*_compile_expr(cmd))(*this);
+}
+
+cutlet::ast::node::pointer
+cutlet::interpreter::_compile_expr(const std::string &cmd) {
+  return _cached_compile(cmd, true, [&](auto source) {
+    tokens->push(source, "<string>");
+    auto compiled = _expression(*tokens);
+    tokens->pop();
+    return compiled;
+  });
+}
+
+/*********************************************
+ * cutlet::interpreter::arguments::arguments *
+ *********************************************/
+
+cutlet::interpreter::arguments::arguments(interpreter &interp)
+  : _interp(interp),
+    _list((interp._arguments_used == interp._arguments.size()
+           ? *interp._arguments.emplace_back(
+               std::make_unique<cutlet::list>())
+           : *interp._arguments[interp._arguments_used])) {
+  // Nested calls each get their own list, one level deeper in the pool.
+  _interp._arguments_used++;
+}
+
+/**********************************************
+ * cutlet::interpreter::arguments::~arguments *
+ **********************************************/
+
+cutlet::interpreter::arguments::~arguments() noexcept {
+  _list.clear();
+  _interp._arguments_used--;
 }
 
 /******************************
@@ -1299,14 +1961,20 @@ int cutlet::interpreter::frames() const {
  *****************************/
 
 void cutlet::interpreter::push(frame::pointer new_frame) {
+  if (_max_depth and _depth >= _max_depth)
+    throw std::runtime_error("Stack depth of " + std::to_string(_max_depth) +
+                             " frames exceeded");
+  ++_depth;
+
   new_frame->parent(_frame);
   _frame = new_frame;
 }
 
 void cutlet::interpreter::push(frame::pointer new_frame, sandbox::pointer sb) {
+  push(new_frame); // XXX This needs to change.
   new_frame->_sandbox_orig = _global;
   _global = sb;
-  push(new_frame); // XXX This needs to change.
+  ++sandbox::_generation;
 }
 
 /****************************
@@ -1321,9 +1989,13 @@ cutlet::variable::pointer cutlet::interpreter::pop() {
   // Retore the frame.
   auto uplevel = _frame->parent();
   _frame = uplevel;
+  if (_depth) --_depth;
 
   // Restore the global environment if necessary.
-  if (sb_saved) _global = sb_saved;
+  if (sb_saved) {
+    _global = sb_saved;
+    ++sandbox::_generation;
+  }
 
   return result;
 }
@@ -1338,6 +2010,71 @@ void cutlet::interpreter::pop(frame::pointer frm) {
   while (_frame != frm) pop();
 }
 
+/**********************************
+ * cutlet::interpreter::tail_call *
+ **********************************/
+
+cutlet::component::pointer
+cutlet::interpreter::tail_call(cutlet::list &arguments) {
+  // A call left for another frame is left for that frame to take.
+  component::pointer result;
+  if (_tail.frame != _frame) return result;
+
+  result = std::move(_tail.function);
+  arguments.swap(_tail.arguments);
+  _tail.frame.reset();
+  _tail.arguments.clear();
+  return result;
+}
+
+/****************************
+ * cutlet::interpreter::def *
+ ****************************/
+
+cutlet::variable::pointer
+cutlet::interpreter::def(const cutlet::list &arguments, native_t body,
+                         sandbox::call_cache_t &cache) {
+  // Only the builtin def knows what to do with a native body.
+  auto def = _global->_components.find(_def_name);
+  if (def != _global->_components.end() and def->second == _def)
+    return builtin::def_native(*this, arguments, body);
+
+  return call("def", arguments, cache);
+}
+
+/***********************************
+ * cutlet::interpreter::_tail_call *
+ ***********************************/
+
+bool cutlet::interpreter::_tail_call(const std::string &name,
+                                     cutlet::list &arguments) {
+  // Only the builtin return is understood.
+  auto ret = _global->_components.find(_return_name);
+  if (ret == _global->_components.end() or ret->second != _return)
+    return false;
+
+  // Only def functions can be called from the trampoline.
+  auto function = _global->_components.find(atom::find(name));
+  if (function == _global->_components.end() or
+      not builtin::is_def(function->second))
+    return false;
+
+  /* return has to be finishing a def function's frame, which are the
+   * frames with a layout. If a block frame is in the way, such as try's or
+   * uplevel's, the call has to be made while it's still there.
+   */
+  if (dynamic_cast<block_frame *>(_frame.get()) or not _frame->_layout)
+    return false;
+
+  _tail.frame = _frame;
+  _tail.function = function->second;
+  _tail.arguments.swap(arguments);
+
+  // The same as return without a value.
+  _frame->state(frame::FS_DONE);
+  return true;
+}
+
 /*******************************
  * cutlet::interpreter::import *
  *******************************/
@@ -1351,14 +2088,19 @@ void cutlet::interpreter::import(const std::string &library_name) {
   // Iterate through the library paths.
   for (auto &path: cutlet::cast<cutlet::list>(paths)) {
     std::string dir(*path);
+    const std::string script = dir + "/" + library_name + ".cutlet";
+    const std::string native = dir + "/" + library_name + SOEXT;
 
-    // If the library exists, load it.
-    if (fexists(dir + "/" + library_name + ".cutlet")) {
-      compile_file(dir + "/" + library_name + ".cutlet");
+    /* If the library exists, load it. A native library built from the
+     * script with cutlet --emit-cpp is used in its place, unless the script
+     * has changed since.
+     */
+    if (fexists(native) and not fnewer(script, native)) {
+      load(native);
       lib_loaded = true;
       break;
-    } else if (fexists(dir + "/" + library_name + SOEXT)) {
-      load(dir + "/" + library_name + SOEXT);
+    } else if (fexists(script)) {
+      compile_file(script);
       lib_loaded = true;
       break;
     }
@@ -1388,9 +2130,9 @@ void cutlet::interpreter::entry() {
 
     // Now we only expect commands and comments.
     if (tokens->expect(cutlet::T_COMMENT)) {
-      ast_tree->add(_comment());
+      ast_tree->add(_comment(*tokens));
     } else {
-      auto node = _command();
+      auto node = _command(*tokens);
       ast_tree->add(node);
       if (_interactive) {
         (*node)(*this);
@@ -1398,128 +2140,226 @@ void cutlet::interpreter::entry() {
     }
   }
 
+  ast::node::pointer result = ast_tree;
   if (not _interactive) {
-    (*ast_tree)(*this);
+    ast::optimizer optimize(_optimize);
+    optimize(*ast_tree);
+    if (_bytecode) result = std::make_shared<ast::bytecode>(ast_tree);
+    if (_run) (*result)(*this);
   }
-  _compiled = ast_tree;
+  _compiled = result;
+}
+
+/**************************************
+ * cutlet::interpreter::_parse_chunks *
+ **************************************/
+
+/** Parse a large script by splitting it between top level commands and
+ * having a pool of threads parse the chunks, stitching the results back
+ * together into a single block.
+ * @param threads The most threads to use, 0 for one per CPU.
+ * @return The parsed script, or nullptr if it wasn't worth splitting up or
+ *         there was an error. Parse it normally then to report the error.
+ */
+cutlet::ast::node::pointer
+cutlet::interpreter::_parse_chunks(const std::string &code,
+                                   const std::string &source,
+                                   unsigned int threads) {
+  if (code.length() < parse_chunk_size * 2) return nullptr;
+
+  /* With a single thread splitting the script up only adds the pre-scan,
+   * so it's parsed serially.
+   */
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads < 2) return nullptr;
+
+  auto boundaries = command_boundaries(code, parse_chunk_size);
+  if (boundaries.size() < 2) return nullptr;
+  boundaries.push_back(code.length());
+
+  const auto chunks = boundaries.size() - 1;
+  std::vector<std::vector<ast::node::pointer>> nodes(chunks);
+  std::atomic<std::size_t> next_chunk(0);
+  std::atomic<bool> failed(false);
+
+  auto worker = [&]() {
+    std::size_t chunk;
+    while (not failed and (chunk = next_chunk++) < chunks) {
+      try {
+        // Each chunk gets its own tokenizer, starting at its place in the
+        // script so the positions all line up.
+        cutlet_tokenizer chunk_tokens;
+        chunk_tokens.blocks = &_blocks;
+        chunk_tokens.push(code.substr(boundaries[chunk],
+                                      boundaries[chunk + 1] -
+                                      boundaries[chunk]),
+                          source,
+                          static_cast<std::streamoff>(boundaries[chunk]));
+
+        while (not chunk_tokens.expect(parser::tokenizer::T_EOF)) {
+          while (chunk_tokens.expect(cutlet::T_EOL)) chunk_tokens.next();
+          if (chunk_tokens.expect(parser::tokenizer::T_EOF)) break;
+
+          if (chunk_tokens.expect(cutlet::T_COMMENT))
+            nodes[chunk].push_back(_comment(chunk_tokens));
+          else
+            nodes[chunk].push_back(_command(chunk_tokens));
+        }
+      } catch (...) {
+        failed = true;
+      }
+    }
+  };
+
+  // The calling thread does its share of the work too.
+  std::vector<std::thread> pool;
+  const std::size_t workers = std::min<std::size_t>(threads, chunks);
+  for (std::size_t count = 1; count < workers; ++count)
+    pool.emplace_back(worker);
+  worker();
+  for (auto &thread: pool) thread.join();
+
+  if (failed) return nullptr;
+
+  auto ast_tree = std::make_shared<ast::block>();
+  for (auto &chunk: nodes) {
+    for (auto &node: chunk) ast_tree->add(node);
+  }
+  return ast_tree;
 }
 
 /*********************************
  * cutlet::interpreter::_comment *
  *********************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_comment() {
-  return std::make_shared<ast::comment>(tokens->get_token());
+cutlet::ast::node::pointer
+cutlet::interpreter::_comment(parser::tokenizer &tokens) {
+  return std::make_shared<ast::comment>(tokens.get_token());
 }
 
 /*********************************
  * cutlet::interpreter::_command *
  *********************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_command() {
+cutlet::ast::node::pointer
+cutlet::interpreter::_command(parser::tokenizer &tokens) {
   std::shared_ptr<ast::command> cmd_ast;
 
   // Get the command name.
-  if (tokens->expect(cutlet::T_WORD) or
-      tokens->expect(cutlet::T_BLOCK)) {
+  switch (static_cast<unsigned int>(tokens.front())) {
+  case cutlet::T_WORD:
+  case cutlet::T_BLOCK:
     cmd_ast = std::make_shared<ast::command>(
-                std::make_shared<ast::value>(tokens->get_token()));
-
-  } else if (tokens->expect(cutlet::T_VARIABLE)) {
-    cmd_ast = std::make_shared<ast::command>(_variable());
-
-  } else if (tokens->expect(cutlet::T_SUBCMD)) {
-    cmd_ast = std::make_shared<ast::command>(_subcommand());
-
-  } else if (tokens->expect(cutlet::T_STRING)) {
-    cmd_ast = std::make_shared<ast::command>(_string());
-
-  } else {
-    throw parser::syntax_error("Invalid token", tokens->get_token());
+                std::make_shared<ast::value>(tokens.get_token()), A_VALUE);
+    break;
+  case cutlet::T_VARIABLE:
+    cmd_ast = std::make_shared<ast::command>(_variable(tokens), A_VARIABLE);
+    break;
+  case cutlet::T_SUBCMD:
+    cmd_ast = std::make_shared<ast::command>(_subcommand(tokens), A_COMMAND);
+    break;
+  case cutlet::T_STRING:
+    cmd_ast = std::make_shared<ast::command>(_string(tokens), A_STRING);
+    break;
+  default:
+    throw parser::syntax_error("Invalid token", tokens.get_token());
   }
 
   // Collect the command arguments.
-  while (not tokens->expect(cutlet::T_EOL) and
-         not tokens->expect(parser::tokenizer::T_EOF)) {
-
-    if (tokens->expect(cutlet::T_WORD) or
-               tokens->expect(cutlet::T_BLOCK)) {
-      cmd_ast->parameter(cutlet::var<ast::value>(tokens->get_token()));
-    } else if (tokens->expect(cutlet::T_STRING)) {
-      cmd_ast->parameter(_string());
-    } else if (tokens->expect(cutlet::T_VARIABLE)) {
-      cmd_ast->parameter(_variable());
-    } else if (tokens->expect(cutlet::T_SUBCMD)) {
-      cmd_ast->parameter(_subcommand());
-    } else {
-      throw parser::syntax_error("Invalid token", tokens->get_token());
+  for (;;) {
+    switch (static_cast<unsigned int>(tokens.front())) {
+    case cutlet::T_EOL:
+    case parser::tokenizer::T_EOF:
+      return cmd_ast;
+    case cutlet::T_WORD:
+    case cutlet::T_BLOCK:
+      cmd_ast->parameter(cutlet::var<ast::value>(tokens.get_token()));
+      break;
+    case cutlet::T_STRING:
+      cmd_ast->parameter(_string(tokens));
+      break;
+    case cutlet::T_VARIABLE:
+      cmd_ast->parameter(_variable(tokens));
+      break;
+    case cutlet::T_SUBCMD:
+      cmd_ast->parameter(_subcommand(tokens));
+      break;
+    default:
+      throw parser::syntax_error("Invalid token", tokens.get_token());
     }
   }
-
-  return cmd_ast;
 }
 
 /************************************
  * cutlet::interpreter::_expression *
  ************************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_expression() {
+cutlet::ast::node::pointer
+cutlet::interpreter::_expression(parser::tokenizer &tokens) {
   ast::expression::pointer cmd_ast;
 
   // Get the command name.
-  if (tokens->expect(cutlet::T_WORD) or
-      tokens->expect(cutlet::T_BLOCK)) {
+  switch (static_cast<unsigned int>(tokens.front())) {
+  case cutlet::T_WORD:
+  case cutlet::T_BLOCK:
     cmd_ast = std::make_shared<ast::expression>(
-                std::make_shared<ast::value>(tokens->get_token()));
-
-  } else if (tokens->expect(cutlet::T_VARIABLE)) {
-    cmd_ast = std::make_shared<ast::expression>(_variable());
-
-  } else if (tokens->expect(cutlet::T_SUBCMD)) {
-    cmd_ast = std::make_shared<ast::expression>(_subcommand());
-
-  } else if (tokens->expect(cutlet::T_STRING)) {
-    cmd_ast = std::make_shared<ast::expression>(_string());
-
-  } else {
-    throw parser::syntax_error("Invalid token", tokens->get_token());
+                std::make_shared<ast::value>(tokens.get_token()), A_VALUE);
+    break;
+  case cutlet::T_VARIABLE:
+    cmd_ast = std::make_shared<ast::expression>(_variable(tokens), A_VARIABLE);
+    break;
+  case cutlet::T_SUBCMD:
+    cmd_ast = std::make_shared<ast::expression>(_subcommand(tokens),
+                                                A_COMMAND);
+    break;
+  case cutlet::T_STRING:
+    cmd_ast = std::make_shared<ast::expression>(_string(tokens), A_STRING);
+    break;
+  default:
+    throw parser::syntax_error("Invalid token", tokens.get_token());
   }
 
   // Collect the command arguments.
-  while (not tokens->expect(cutlet::T_EOL) and
-         not tokens->expect(parser::tokenizer::T_EOF)) {
-
-    if (tokens->expect(cutlet::T_WORD) or
-               tokens->expect(cutlet::T_BLOCK)) {
-      cmd_ast->parameter(cutlet::var<ast::value>(tokens->get_token()));
-    } else if (tokens->expect(cutlet::T_STRING)) {
-      cmd_ast->parameter(_string());
-    } else if (tokens->expect(cutlet::T_VARIABLE)) {
-      cmd_ast->parameter(_variable());
-    } else if (tokens->expect(cutlet::T_SUBCMD)) {
-      cmd_ast->parameter(_subcommand());
-    } else {
-      throw parser::syntax_error("Invalid token", tokens->get_token());
+  for (;;) {
+    switch (static_cast<unsigned int>(tokens.front())) {
+    case cutlet::T_EOL:
+    case parser::tokenizer::T_EOF:
+      return cmd_ast;
+    case cutlet::T_WORD:
+    case cutlet::T_BLOCK:
+      cmd_ast->parameter(cutlet::var<ast::value>(tokens.get_token()));
+      break;
+    case cutlet::T_STRING:
+      cmd_ast->parameter(_string(tokens));
+      break;
+    case cutlet::T_VARIABLE:
+      cmd_ast->parameter(_variable(tokens));
+      break;
+    case cutlet::T_SUBCMD:
+      cmd_ast->parameter(_subcommand(tokens));
+      break;
+    default:
+      throw parser::syntax_error("Invalid token", tokens.get_token());
     }
   }
-
-  return cmd_ast;
 }
 
 /**********************************
  * cutlet::interpreter::_variable *
  **********************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_variable() {
-  return cutlet::var<ast::variable>(tokens->get_token());
+cutlet::ast::node::pointer
+cutlet::interpreter::_variable(parser::tokenizer &tokens) {
+  return cutlet::var<ast::variable>(tokens.get_token());
 }
 
 /********************************
  * cutlet::interpreter::_string *
  ********************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_string() {
-  auto token = tokens->get_token();
+cutlet::ast::node::pointer
+cutlet::interpreter::_string(parser::tokenizer &tokens) {
+  auto token = tokens.get_token();
   auto ast_str = std::make_shared<ast::string>(token);
   std::string result(static_cast<const std::string &>(token));
   std::string part;
@@ -1529,7 +2369,7 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
   auto s_index = index;
   for (; index != index.end(); ++index) {
 
-    if (*index == "$") {
+    if (index.view() == "$") {
       // Variable substitution.
 
       if (not part.empty()) {
@@ -1542,10 +2382,10 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
       auto start = index;
       ++index;
 
-      if (*index == "{") {
+      if (index.view() == "{") {
         // Quoted variable name.
         ++index;
-        while (*index != "}" and index != index.end()) ++index;
+        while (index.view() != "}" and index != index.end()) ++index;
         if (index == index.end())
           throw parser::syntax_error("Unmatched ${ in string", token);
 
@@ -1559,7 +2399,7 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
       } else {
         // Unquoted variable name.
         ++index;
-        while ((*index != "$" and not is_space(*index)) and
+        while ((index.view() != "$" and not is_space(index.view())) and
                index != index.end())
           ++index;
 
@@ -1573,7 +2413,7 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
         --index;
       }
 
-    } else if (*index == "[") {
+    } else if (index.view() == "[") {
       // Subcommand substitution.
 
       if (not part.empty()) {
@@ -1584,7 +2424,7 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
 
       auto start = index;
       ++index;
-      while (*index != "]" and index != index.end()) ++index;
+      while (index.view() != "]" and index != index.end()) ++index;
       if (index == index.end())
         throw parser::syntax_error("Unmatched [ in string", token);
 
@@ -1592,54 +2432,54 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
                         utf8::substr(start + 1, index),
                         static_cast<size_t>(token.position()) +
                         start.position() + 1, 1);
-      tokens->push(cmd);
-      ast_str->add(_command());
-      tokens->pop();
+      tokens.push(cmd);
+      ast_str->add(_command(tokens));
+      tokens.pop();
 
-    } else if (*index == "\\") {
+    } else if (index.view() == "\\") {
       // Escaped characters.
 
       auto start = index;
       ++index;
-      if (*index == "$")
+      if (index.view() == "$")
         part += "$";
-      else if (*index == "\"")
+      else if (index.view() == "\"")
         part += "\"";
-      else if (*index == "'")
+      else if (index.view() == "'")
         part += "'";
-      else if (*index == "[")
+      else if (index.view() == "[")
         part += "[";
-      else if (*index == "]")
+      else if (index.view() == "]")
         part += "]";
-      else if (*index == "\\")
+      else if (index.view() == "\\")
         part += "\\";
 
 
-      else if (*index == "a") // Bell/Alarm
+      else if (index.view() == "a") // Bell/Alarm
         part += "\x07";
-      else if (*index == "b") // Backspace
+      else if (index.view() == "b") // Backspace
         part += "\x08";
-      else if (*index == "e") // Escape
+      else if (index.view() == "e") // Escape
         part += "\x1b";
-      else if (*index == "f") // Form feed
+      else if (index.view() == "f") // Form feed
         part += "\x0c";
-      else if (*index == "n") // New line (line feed)
+      else if (index.view() == "n") // New line (line feed)
         part += "\x0a";
-      else if (*index == "r") // Carrage return
+      else if (index.view() == "r") // Carrage return
         part += "\x0d";
-      else if (*index == "t") // Horizontal tab
+      else if (index.view() == "t") // Horizontal tab
         part += "\x09";
-      else if (*index == "v") // Vertical tab
+      else if (index.view() == "v") // Vertical tab
         part += "\x0b";
 
-      else if (*index == "x") { // Hex byte values.
+      else if (index.view() == "x") { // Hex byte values.
         ++index;
         std::string value;
         for (int count = 0; count < 2; ++count, ++index) {
-          value += *index;
-          if ((*index >= "0" and *index <= "9") or
-              (*index >= "A" and *index <= "F") or
-              (*index >= "a" and *index <= "f")) {
+          value += index.view();
+          if ((index.view() >= "0" and index.view() <= "9") or
+              (index.view() >= "A" and index.view() <= "F") or
+              (index.view() >= "a" and index.view() <= "f")) {
           } else {
             throw std::runtime_error(
               std::string("Invalid escaped hex value \\x") + value);
@@ -1669,7 +2509,7 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
 
     } else {
       // Collect the actual literal parts of the string.
-      part += *index;
+      part += index.view();
     }
   }
 
@@ -1684,11 +2524,16 @@ cutlet::ast::node::pointer cutlet::interpreter::_string() {
  * cutlet::interpreter::_subcommand *
  ************************************/
 
-cutlet::ast::node::pointer cutlet::interpreter::_subcommand() {
-  tokens->push();
-  ast::node::pointer result = _command();
-  tokens->pop();
+cutlet::ast::node::pointer
+cutlet::interpreter::_subcommand(parser::tokenizer &tokens) {
+  tokens.push();
+  ast::node::pointer result = _command(tokens);
+  tokens.pop();
   return result;
 }
 
+std::atomic<unsigned int> cutlet::sandbox::_generation(1);
+std::atomic<unsigned long> cutlet::sandbox::_cache_hits(0);
+std::atomic<unsigned long> cutlet::sandbox::_cache_misses(0);
+
 unsigned int cutlet::interpreter::_interpreters = 0;
@@ -29,11 +29,55 @@
  */
 
 #include <cutlet>
+#include <algorithm>
+
+namespace {
+  // Layout ids start at 1 so an empty slot cache never matches.
+  std::atomic<unsigned long> _layouts(1);
+
+  /* A slot cache word is the layout id above the slot's index. The index
+   * has SLOT_BITS, and the largest one is left for names the layout
+   * doesn't have.
+   */
+  const unsigned int SLOT_BITS = 24;
+  const unsigned long long NO_SLOT = (1ULL << SLOT_BITS) - 1;
+
+  /* The slot name has in layout, looked up through cache. A layout too big
+   * for the cache is searched each time.
+   */
+  unsigned long long
+  find_slot(const cutlet::frame::layout_s &layout, const std::string &name,
+            cutlet::frame::slot_cache_t &cache) {
+    const unsigned long long tag = (unsigned long long)layout.id << SLOT_BITS;
+    unsigned long long cached = cache.slot.load(std::memory_order_relaxed);
+    if ((cached & ~NO_SLOT) == tag) return cached & NO_SLOT;
+
+    const auto slot = layout.slots.find(name);
+    unsigned long long index = (slot != layout.slots.end() ?
+                                slot->second : NO_SLOT);
+    if (index < NO_SLOT or slot == layout.slots.end())
+      cache.slot.store(tag | index, std::memory_order_relaxed);
+    return index;
+  }
+}
 
 /******************************************************************************
  * class cutlet::frame
  */
 
+/******************************
+ * cutlet::frame::make_layout *
+ ******************************/
+
+cutlet::frame::layout_t
+cutlet::frame::make_layout(const std::vector<std::string> &names) {
+  auto result = std::make_shared<layout_s>();
+  result->id = _layouts++;
+  for (auto &name: names)
+    result->slots.emplace(name, result->slots.size());
+  return result;
+}
+
 /************************
  * cutlet::frame::frame *
  ************************/
@@ -44,6 +88,9 @@ cutlet::frame::frame(const std::string &label)
 cutlet::frame::frame(pointer uplevel, const std::string &label)
   : _uplevel(uplevel), _state(FS_RUNNING), _label(label) {}
 
+cutlet::frame::frame(pointer uplevel, variable::pointer label)
+  : _uplevel(uplevel), _state(FS_RUNNING), _label_value(label) {}
+
 /*************************
  * cutlet::frame::~frame *
  *************************/
@@ -58,17 +105,105 @@ cutlet::frame::~frame() noexcept {
 
 cutlet::variable::pointer
 cutlet::frame::variable(const std::string &name) const {
+  if (_layout) {
+    const auto slot = _layout->slots.find(name);
+    if (slot != _layout->slots.end())
+      return _slots[slot->second];
+    if (_variables.empty()) return nullptr;
+  }
+
   // Search for the variable and return it's value if it is found.
+  return local(atom::find(name));
+}
+
+void cutlet::frame::variable(const std::string &name,
+                             variable::pointer value) {
+  if (_layout) {
+    auto slot = _layout->slots.find(name);
+    if (slot != _layout->slots.end()) {
+      _slots[slot->second] = value;
+      return;
+    }
+  }
+
+  /* Names not in the layout are kept by name. They could be anything made
+   * up at run time, ie. local $name, so they aren't given slots.
+   */
+  local(atom(name), value);
+}
+
+cutlet::variable::pointer
+cutlet::frame::variable(const std::string &name, slot_cache_t &cache) const {
+  // Frames without a layout are searched by name, as they may override it.
+  if (not _layout) return variable(name);
+
+  const unsigned long long index = find_slot(*_layout, name, cache);
+  if (index < _slots.size()) return _slots[index];
+  if (_variables.empty()) return nullptr;
+  return local(cache.intern(name));
+}
+
+void cutlet::frame::variable(const std::string &name,
+                             variable::pointer value, slot_cache_t &cache) {
+  if (not _layout) {
+    variable(name, value);
+    return;
+  }
+
+  const unsigned long long index = find_slot(*_layout, name, cache);
+  if (index < _slots.size()) {
+    _slots[index] = value;
+    return;
+  }
+
+  const atom key = cache.intern(name);
+  if (not value or local(key)) {
+    local(key, value);
+    return;
+  }
+
+  /* A new name set where it's written in the code, so give it a slot in a
+   * copy of our layout. The cache picks up the slot next time.
+   */
+  auto grown = std::make_shared<layout_s>(*_layout);
+  grown->id = _layouts++;
+  grown->slots.emplace(name, _slots.size());
+  _layout = grown;
+  _slots.push_back(value);
+}
+
+cutlet::list cutlet::frame::variables() const {
+  // The names are sorted, as neither the slots nor the variables are.
+  std::vector<std::string> set;
+  if (_layout) {
+    for (auto &it: _layout->slots) {
+      if (_slots[it.second]) set.push_back(it.first);
+    }
+  }
+  for (auto &it: _variables) set.push_back(it.first.str());
+  std::sort(set.begin(), set.end());
+
+  cutlet::list names;
+  for (auto &name: set) {
+    names.push_back(std::make_shared<cutlet::string>(name));
+  }
+  return names;
+}
+
+/************************
+ * cutlet::frame::local *
+ ************************/
+
+cutlet::variable::pointer cutlet::frame::local(const atom &name) const {
+  if (_variables.empty()) return nullptr;
+
   const auto item = _variables.find(name);
   if (item != _variables.end())
     return item->second;
-
-  // Return a null value if we don't have it.
   return nullptr;
 }
 
-void cutlet::frame::variable(const std::string &name,
-                             variable::pointer value) {
+void cutlet::frame::local(const atom &name, variable::pointer value) {
   if (not value) {
     // If the value in null erase the variable from the frame.
     _variables.erase(name);
@@ -78,12 +213,23 @@ void cutlet::frame::variable(const std::string &name,
   }
 }
 
-cutlet::list cutlet::frame::variables() const {
-  cutlet::list names;
-  for (auto &it: _variables) {
-    names.push_back(std::make_shared<cutlet::string>(it.first));
+/*************************
+ * cutlet::frame::layout *
+ *************************/
+
+void cutlet::frame::layout(layout_t value) {
+  // Variables already set are moved over to the new layout.
+  atom_map<variable::pointer> current;
+  current.swap(_variables);
+  if (_layout) {
+    for (auto &it: _layout->slots) {
+      if (_slots[it.second]) current[atom(it.first)] = _slots[it.second];
+    }
   }
-  return names;
+
+  _layout = value;
+  _slots.assign(_layout ? _layout->slots.size() : 0, nullptr);
+  for (auto &it: current) variable(it.first, it.second);
 }
 
 /***********************
@@ -125,9 +271,12 @@ void cutlet::frame::state(cutlet::frame::state_t new_state) {
 
 void cutlet::frame::label(const std::string &value) {
   _label = value;
+  _label_value.reset();
 }
 
 std::string cutlet::frame::label() const {
+  // A label given as a variable is only turned into a string when needed.
+  if (_label_value) return *_label_value;
   return _label;
 }
 
@@ -188,6 +337,10 @@ cutlet::block_frame::block_frame(const std::string &label,
                                  cutlet::frame::pointer uplevel)
   : frame(uplevel, label) {}
 
+cutlet::block_frame::block_frame(variable::pointer label,
+                                 cutlet::frame::pointer uplevel)
+  : frame(uplevel, label) {}
+
 /*************************************
  * cutlet::block_frame::~block_frame *
  *************************************/
@@ -211,6 +364,15 @@ cutlet::block_frame::variable(const std::string &name) const {
   return result;
 }
 
+cutlet::variable::pointer
+cutlet::block_frame::variable(const std::string &name,
+                              slot_cache_t &cache) const {
+  cutlet::variable::pointer result = local(cache.intern(name));
+  if (not result)
+    result = _uplevel->variable(name, cache);
+  return result;
+}
+
 void cutlet::block_frame::variable(const std::string &name,
                                    variable::pointer value) {
   // First we see if this frame has the variable.
@@ -231,6 +393,18 @@ void cutlet::block_frame::variable(const std::string &name,
   cutlet::frame::variable(name, value);
 }
 
+void cutlet::block_frame::variable(const std::string &name,
+                                   variable::pointer value,
+                                   slot_cache_t &cache) {
+  // The same as above, with the cache passed on to the upper levels.
+  const atom key = cache.intern(name);
+  if (not local(key) and _uplevel->variable(name, cache)) {
+    _uplevel->variable(name, value, cache);
+    return;
+  }
+  local(key, value);
+}
+
 /*****************************
  * cutlet::block_frame::done *
  *****************************/
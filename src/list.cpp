@@ -463,122 +463,120 @@ std::string cutlet::list::join(const std::string &delim) const {
 cutlet::variable::pointer cutlet::list::operator()(variable::pointer self,
                                                    interpreter &interp,
                                                    const list &arguments) {
+  return _operator(self, interp, SEL_NONE, arguments, false);
+}
+
+/************************
+ * cutlet::list::method *
+ ************************/
+
+cutlet::variable::pointer cutlet::list::method(variable::pointer self,
+                                               interpreter &interp,
+                                               selector_t op,
+                                               const list &arguments) {
+  return _operator(self, interp, op, arguments, true);
+}
+
+/***************************
+ * cutlet::list::_operator *
+ ***************************/
+
+cutlet::variable::pointer
+cutlet::list::_operator(variable::pointer self, interpreter &interp,
+                        selector_t op, const list &arguments,
+                        bool fallback) {
   (void)self;
 
-  std::string op = *(arguments[0]);
+  if (op == SEL_NONE) op = selector(arguments);
 
-  switch (op[0]) {
-  case '=':
-    if (op == "==" or op == "=") {
-      // $list == $other or $list = $other
-      return _equal(*this, interp, arguments);
-    }
-    break;
-  case '<':
-  case '!':
-    if (op == "<>" or op == "!=") {
-      // $list <> $other or $list != $other
-      return _nequal(*this, interp, arguments);
-    }
-    break;
-  case 'a':
-    if (op == "append") {
-      // $list append *args
-      return _append(*this, interp, arguments);
-    }
-    break;
-  case 'c':
-    if (op == "clear") {
-      // $list clear
-
-      if (arguments.size() == 1) {
-        clear();
-        return nullptr;
-      } else {
-        throw std::runtime_error(std::string("Invalid number of arguments to "
-                                             "$list operator clear"));
-      }
-    }
-    break;
-  case 'e':
-    if (op == "extend") {
-      // $list extend *args
-      return _extend(*this, interp, arguments);
-    }
-    break;
-  case 'f':
-    if (op == "foreach") {
-      // $list foreach item body
-      return _foreach(*this, interp, arguments);
-    }
-    break;
-  case 'i':
-    if (op == "index") {
-      // $list index index ¿¿=? value?
-      return _index(*this, interp, arguments);
-    }
-    break;
-  case 'j':
-    if (op == "join") {
-      // $list join ¿delim?
-      return _join(*this, interp, arguments);
-    }
-    break;
-  case 'p':
-    if (op == "prepend") {
-      // $list prepend *args
-      return _prepend(*this, interp, arguments);
-    }
-    break;
-  case 'r':
-    if (op == "remove") {
-      // $list remove index ¿end?
-      return _remove(*this, interp, arguments);
-
-    } else if (op == "reverse") {
-      // $list remove index ¿end?
-      return _reverse(*this, interp, arguments);
-    }
-    break;
-  case 's':
-    if (op == "shuffle") {
-      // $list shuffle
-      return _shuffle(*this, interp, arguments);
-
-    } else if (op == "size") {
-      // $list size
-      if (arguments.size() == 1) {
-        return std::make_shared<cutlet::string>(size());
-      } else {
-        throw std::runtime_error(std::string("Invalid number of arguments to "
-                                             "$list size"));
-      }
-    } else if (op == "sort") {
-      // $list sort ¿less?
-      return _sort(*this, interp, arguments);
+  switch (op) {
+  case SEL_EQUAL:
+    // $list == $other or $list = $other
+    return _equal(*this, interp, arguments);
+
+  case SEL_NOT_EQUAL:
+    // $list <> $other or $list != $other
+    return _nequal(*this, interp, arguments);
+
+  case SEL_APPEND:
+    // $list append *args
+    return _append(*this, interp, arguments);
+
+  case SEL_CLEAR:
+    // $list clear
+    if (arguments.size() == 1) {
+      clear();
+      return nullptr;
+    } else {
+      throw std::runtime_error(std::string("Invalid number of arguments to "
+                                           "$list operator clear"));
     }
-    break;
-  case 't':
-    if (op == "type") {
-      // $list type
-      if (arguments.size() == 1) {
-        return std::make_shared<cutlet::string>("list");
-      } else {
-        throw std::runtime_error(std::string("Invalid number of arguments to "
-                                             "$list type"));
-      }
+
+  case SEL_EXTEND:
+    // $list extend *args
+    return _extend(*this, interp, arguments);
+
+  case SEL_FOREACH:
+    // $list foreach item body
+    return _foreach(*this, interp, arguments);
+
+  case SEL_INDEX:
+    // $list index index ¿¿=? value?
+    return _index(*this, interp, arguments);
+
+  case SEL_JOIN:
+    // $list join ¿delim?
+    return _join(*this, interp, arguments);
+
+  case SEL_PREPEND:
+    // $list prepend *args
+    return _prepend(*this, interp, arguments);
+
+  case SEL_REMOVE:
+    // $list remove index ¿end?
+    return _remove(*this, interp, arguments);
+
+  case SEL_REVERSE:
+    // $list reverse
+    return _reverse(*this, interp, arguments);
+
+  case SEL_SHUFFLE:
+    // $list shuffle
+    return _shuffle(*this, interp, arguments);
+
+  case SEL_SIZE:
+    // $list size
+    if (arguments.size() == 1) {
+      return std::make_shared<cutlet::string>(size());
+    } else {
+      throw std::runtime_error(std::string("Invalid number of arguments to "
+                                           "$list size"));
     }
-    break;
-  case 'u':
-    if (op == "unique") {
-      // $list unique
-      return _unique(*this, interp, arguments);
+
+  case SEL_SORT:
+    // $list sort ¿less?
+    return _sort(*this, interp, arguments);
+
+  case SEL_TYPE:
+    // $list type
+    if (arguments.size() == 1) {
+      return std::make_shared<cutlet::string>("list");
+    } else {
+      throw std::runtime_error(std::string("Invalid number of arguments to "
+                                           "$list type"));
     }
-    break;
+
+  case SEL_UNIQUE:
+    // $list unique
+    return _unique(*this, interp, arguments);
   }
 
+  // Not one of ours, but a subclass may have added it to operator().
+  if (fallback) return (*this)(self, interp, arguments);
+
   throw std::runtime_error(std::string("Unknown operator ") +
-                           op + " for list variable.");
+                           static_cast<std::string>(*(arguments[0])) +
+                           " for list variable.");
 }
 
 /**************************************
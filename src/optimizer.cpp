@@ -0,0 +1,101 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "optimizer.h"
+#include <iterator>
+
+/******************************************************************************
+ * class cutlet::ast::optimizer
+ */
+
+/*************************************
+ * cutlet::ast::optimizer::optimizer *
+ *************************************/
+
+cutlet::ast::optimizer::optimizer(unsigned int level) : _level(level) {}
+
+/***************************************
+ * cutlet::ast::optimizer::operator () *
+ ***************************************/
+
+void cutlet::ast::optimizer::operator()(block &tree) {
+  if (_level == 0) return;
+
+  // Comments are where a debugger stops, so they stay while one is set.
+  if (not node::_debug_function) {
+    tree._nodes.remove_if([](const node::pointer &n) {
+      return dynamic_cast<comment *>(n.get()) != nullptr;
+    });
+  }
+
+  optimize(tree._nodes);
+}
+
+/************************************
+ * cutlet::ast::optimizer::optimize *
+ ************************************/
+
+void cutlet::ast::optimizer::optimize(node &n) {
+  if (auto cmd = dynamic_cast<command *>(&n)) {
+    optimize(*cmd->_function);
+    optimize(cmd->_parameters);
+
+  } else if (auto expr = dynamic_cast<expression *>(&n)) {
+    optimize(*expr->_function);
+    optimize(expr->_parameters);
+
+  } else if (auto str = dynamic_cast<string *>(&n)) {
+    auto &parts = str->_stringy;
+    for (auto &part: parts) {
+      if (part.n) optimize(*part.n);
+    }
+
+    // Merge literal parts that follow each other.
+    for (auto part = parts.begin(); part != parts.end(); ++part) {
+      auto next = std::next(part);
+      while (next != parts.end() and not part->n and not next->n) {
+        part->s += next->s;
+        next = parts.erase(next);
+      }
+    }
+
+    // Nothing to substitute, the string is always the same.
+    if (parts.empty())
+      str->_constant = cutlet::var<cutlet::string>("");
+    else if (parts.size() == 1 and not parts.front().n)
+      str->_constant = cutlet::var<cutlet::string>(parts.front().s);
+  }
+}
+
+void cutlet::ast::optimizer::optimize(std::list<node::pointer> &nodes) {
+  for (auto &n: nodes) {
+    if (n) optimize(*n);
+  }
+}
@@ -29,7 +29,10 @@
  */
 
 #include <libcutlet/parser>
+#include "automaton.h"
 #include <iostream>
+#include <mutex>
+#include <unordered_set>
 
 //#define DEBUG_PARSER 1
 
@@ -48,12 +51,42 @@ std::ostream &operator <<(std::ostream &os, const parser::token &token) {
 
 std::ostream &operator <<(std::ostream &os,
                           const parser::tokenizer &tokenizer) {
-  for (auto &token : tokenizer.tokens) {
-    os << token << "\n";
+  for (std::size_t index = 0; index < tokenizer.tokens.size(); ++index) {
+    os << tokenizer.tokens[index] << "\n";
   }
   return os;
 }
 
+namespace {
+
+  /* The value shared by all the empty tokens, such as EOF. */
+  const std::shared_ptr<const std::string> &empty_value() {
+    static const auto value = std::make_shared<const std::string>();
+    return value;
+  }
+
+  std::shared_ptr<const std::string> make_value(const std::string &value) {
+    if (value.empty()) return empty_value();
+    return std::make_shared<const std::string>(value);
+  }
+
+  std::shared_ptr<const std::string> make_value(std::string &&value) {
+    if (value.empty()) return empty_value();
+    return std::make_shared<const std::string>(std::move(value));
+  }
+
+  /* All the file names tokens have been read from. Names are never removed,
+   * so the pointers handed out stay valid for the life of the process.
+   */
+  const std::string *intern_file(const std::string &name) {
+    static std::mutex mtx;
+    static std::unordered_set<std::string> names;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    return &*names.insert(name).first;
+  }
+}
+
 /******************************************************************************
  * class parser::token
  */
@@ -79,14 +112,19 @@ parser::token::token(const token &other)
     case 7: std::clog << "EOL"; break;
     }
     std::clog << ":" << _position << ":" << _offset
-              << ": " << _value << std::endl;
+              << ": " << *_value << std::endl;
               }*/
 #endif
 }
 
+parser::token::token(token &&other) noexcept
+  : _id(other._id), _value(std::move(other._value)), _file(other._file),
+    _position(other._position), _offset(other._offset) {
+}
+
 parser::token::token(unsigned int id, const std::string &value,
                      std::streampos position, std::streamoff offset)
-  : _id(id), _value(value), _position(position), _offset(offset) {
+  : _id(id), _value(make_value(value)), _position(position), _offset(offset) {
 #if defined(DEBUG_PARSER)
   if (_id != 7) {
     std::clog << "TOKEN:";
@@ -101,11 +139,17 @@ parser::token::token(unsigned int id, const std::string &value,
     case 7: std::clog << "EOL"; break;
     }
     std::clog << ":" << _position << ":" << _offset
-              << ": " << _value << std::endl;
+              << ": " << *_value << std::endl;
   }
 #endif
 }
 
+parser::token::token(unsigned int id, std::string &&value,
+                     std::streampos position, std::streamoff offset)
+  : _id(id), _value(make_value(std::move(value))), _position(position),
+    _offset(offset) {
+}
+
 /*************************
  * parser::token::~token *
  *************************/
@@ -127,12 +171,24 @@ parser::token &parser::token::operator =(const token &other) {
   return *this;
 }
 
+parser::token &parser::token::operator =(token &&other) noexcept {
+  if (this != &other) {
+    _id = other._id;
+    _value = std::move(other._value);
+    _file = other._file;
+    _position = other._position;
+    _offset = other._offset;
+  }
+  return *this;
+}
+
 /******************************
  * parser::token::operator == *
  ******************************/
 
 bool parser::token::operator ==(const token &other) const {
-  if (_id == other._id and _value == other._value)
+  if (_id == other._id and
+      (_value == other._value or *_value == *other._value))
     return true;
   return false;
 }
@@ -141,6 +197,93 @@ bool parser::token::operator ==(unsigned int id) const {
   return _id == id;
 }
 
+/******************************************************************************
+ * class parser::token_queue
+ */
+
+/************************************
+ * parser::token_queue::token_queue *
+ ************************************/
+
+parser::token_queue::token_queue(token_queue &&other) noexcept
+  : _buffer(std::move(other._buffer)), _head(other._head),
+    _size(other._size) {
+  other._buffer.clear();
+  other._head = 0;
+  other._size = 0;
+}
+
+/***********************************
+ * parser::token_queue::operator = *
+ ***********************************/
+
+parser::token_queue &
+parser::token_queue::operator =(token_queue &&other) noexcept {
+  if (this != &other) {
+    _buffer = std::move(other._buffer);
+    _head = other._head;
+    _size = other._size;
+    other._buffer.clear();
+    other._head = 0;
+    other._size = 0;
+  }
+  return *this;
+}
+
+/**********************************
+ * parser::token_queue::push_back *
+ **********************************/
+
+void parser::token_queue::push_back(const token &value) {
+  if (_size == _buffer.size()) grow();
+  (*this)[_size++] = value;
+}
+
+void parser::token_queue::push_back(token &&value) {
+  if (_size == _buffer.size()) grow();
+  (*this)[_size++] = std::move(value);
+}
+
+/**********************************
+ * parser::token_queue::pop_front *
+ **********************************/
+
+void parser::token_queue::pop_front() {
+  // Let go of the value now rather than when the slot gets reused.
+  _buffer[_head]._value.reset();
+  _head = (_head + 1) & (_buffer.size() - 1);
+  --_size;
+}
+
+/******************************
+ * parser::token_queue::clear *
+ ******************************/
+
+void parser::token_queue::clear() noexcept {
+  for (std::size_t index = 0; index < _size; ++index)
+    (*this)[index]._value.reset();
+  _head = 0;
+  _size = 0;
+}
+
+/*****************************
+ * parser::token_queue::grow *
+ *****************************/
+
+void parser::token_queue::grow() {
+  std::vector<token> buffer;
+  const auto capacity = (_buffer.empty() ? 16 : _buffer.size() * 2);
+  buffer.reserve(capacity);
+
+  // Unwrap the tokens to the start of the new buffer.
+  for (std::size_t index = 0; index < _size; ++index)
+    buffer.push_back(std::move((*this)[index]));
+  while (buffer.size() < capacity) buffer.emplace_back(0, std::string());
+
+  _buffer = std::move(buffer);
+  _head = 0;
+}
+
 /******************************************************************************
  * class parser::syntax_error
  */
@@ -239,7 +382,7 @@ void parser::tokenizer::parse(std::istream &source) {
 
 parser::token parser::tokenizer::get_token() {
   if (is_more()) {
-    auto result = tokens.front();
+    token result(std::move(tokens.front()));
     tokens.pop_front();
     return result;
   }
@@ -250,7 +393,7 @@ parser::token parser::tokenizer::get_token() {
  * parser::tokenizer::front *
  ****************************/
 
-parser::token parser::tokenizer::front() {
+const parser::token &parser::tokenizer::front() {
   if (is_more()) return tokens.front();
   throw syntax_error("Incomplete syntax", token(T_INVALID, "", position));
 }
@@ -269,8 +412,9 @@ bool parser::tokenizer::expect(unsigned int id) noexcept {
 bool parser::tokenizer::expect(unsigned int id,
                                const std::string &value) noexcept {
   if (is_more()) {
-    token tk(id, value);
-    return (tokens.front() == tk);
+    // Compare in place rather than building a token to compare with.
+    const token &next = tokens.front();
+    return (next._id == id and *next._value == value);
   }
   return false;
 }
@@ -309,7 +453,15 @@ bool parser::tokenizer::is_more_code() {
     /*  Attempt to read a line and set the EOF token if the stream is
      * exhausted.
      */
-    if (code.empty()) position = stream->tellg();
+    if (cursor >= code.length()) {
+      code.clear();
+      cursor = 0;
+      position = stream->tellg();
+    } else if (cursor) {
+      // Drop the consumed code before appending more to the buffer.
+      code.erase(0, cursor);
+      cursor = 0;
+    }
     std::string line;
 
     if (not getline(*stream, line)) {
@@ -321,7 +473,7 @@ bool parser::tokenizer::is_more_code() {
 
     }
     return true;
-  } else if (not code.empty()) {
+  } else if (remaining()) {
     return true;
   }
 
@@ -356,9 +508,23 @@ void parser::tokenizer::next() {
 void parser::tokenizer::reset() noexcept {
   tokens.clear();
   code.clear();
+  shared_code.reset();
+  cursor = 0;
   stream = nullptr;
 }
 
+/*********************************
+ * parser::tokenizer::save_state *
+ *********************************/
+
+void parser::tokenizer::save_state() {
+  /* The state is about to be reset, so move it rather than copying what
+   * could be the rest of a large file.
+   */
+  _states.push({std::move(tokens), std::move(code), std::move(shared_code),
+                file, stream, cursor, position});
+}
+
 /***************************
  * parser::tokenizer::push *
  ***************************/
@@ -368,11 +534,11 @@ void parser::tokenizer::push() {
 #if defined(DEBUG_PARSER)
   std::clog << "TOKENIZER: pushing last token: " << token << std::endl;
 #endif
-  _states.push({tokens, code, file, stream, position});
+  save_state();
   reset();
   position = token._position + token._offset;
-  code = token._value;
-  file = token._file;
+  shared_code = token._value;
+  file = token.file();
   parse_tokens();
 }
 
@@ -380,11 +546,11 @@ void parser::tokenizer::push(token value) {
 #if defined(DEBUG_PARSER)
   std::clog << "TOKENIZER: pushing token: " << value << std::endl;
 #endif
-  _states.push({tokens, code, file, stream, position});
+  save_state();
   reset();
   position = value._position + value._offset;
-  code = value._value;
-  file = value._file;
+  shared_code = value._value;
+  file = value.file();
   parse_tokens();
 }
 
@@ -392,7 +558,7 @@ void parser::tokenizer::push(const std::string &value) {
 #if defined(DEBUG_PARSER)
   std::clog << "TOKENIZER: pushing string" << std::endl;
 #endif
-  _states.push({tokens, code, file, stream, position});
+  save_state();
   reset();
   position = 0;
   code = value;
@@ -400,11 +566,39 @@ void parser::tokenizer::push(const std::string &value) {
   parse_tokens();
 }
 
+void parser::tokenizer::push(const std::string &value,
+                             const std::string &source) {
+#if defined(DEBUG_PARSER)
+  std::clog << "TOKENIZER: pushing source " << source << std::endl;
+#endif
+  save_state();
+  reset();
+  position = 0;
+  code = value;
+  file = source;
+  parse_tokens();
+}
+
+void parser::tokenizer::push(const std::string &value,
+                             const std::string &source,
+                             std::streampos spos) {
+#if defined(DEBUG_PARSER)
+  std::clog << "TOKENIZER: pushing source " << source << " at " << spos
+            << std::endl;
+#endif
+  save_state();
+  reset();
+  position = spos;
+  code = value;
+  file = source;
+  parse_tokens();
+}
+
 void parser::tokenizer::push(std::istream &value, const std::string &source) {
 #if defined(DEBUG_PARSER)
   std::clog << "TOKENIZER: pushing stream " << source << std::endl;
 #endif
-  _states.push({tokens, code, file, stream, position});
+  save_state();
   reset();
   position = value.tellg();
   stream = &value;
@@ -413,6 +607,19 @@ void parser::tokenizer::push(std::istream &value, const std::string &source) {
   parse_tokens();
 }
 
+void parser::tokenizer::push(std::shared_ptr<const std::string> value,
+                             const std::string &source) {
+#if defined(DEBUG_PARSER)
+  std::clog << "TOKENIZER: pushing shared source " << source << std::endl;
+#endif
+  save_state();
+  reset();
+  position = 0;
+  shared_code = std::move(value);
+  file = source;
+  parse_tokens();
+}
+
 /**************************
  * parser::tokenizer::pop *
  **************************/
@@ -422,14 +629,16 @@ void parser::tokenizer::pop() {
   std::clog << "TOKENIZER: popping" << std::endl;
 #endif
   auto &top = _states.top();
-  tokens = top.tokens;
-  code = top.code;
-  file = top.file;
+  tokens = std::move(top.tokens);
+  code = std::move(top.code);
+  shared_code = std::move(top.shared_code);
+  file = std::move(top.file);
   stream = top.stream;
+  cursor = top.cursor;
   position = top.position;
   _states.pop();
 #if defined(DEBUG_PARSER)
-  std::clog << "           " << code << std::endl;
+  std::clog << "           " << buffer().substr(cursor) << std::endl;
 #endif
 }
 
@@ -439,7 +648,10 @@ void parser::tokenizer::pop() {
 
 void parser::tokenizer::add_token_pattern(unsigned int token_id,
                                           const std::string &pattern) {
-  _patterns.push_back({token_id, std::regex(pattern, std::regex::ECMAScript)});
+  _patterns.push_back({token_id, pattern,
+                       std::regex(pattern, std::regex::ECMAScript)});
+  _automaton.reset();
+  _automaton_built = false;
 }
 
 /*******************************************
@@ -448,6 +660,8 @@ void parser::tokenizer::add_token_pattern(unsigned int token_id,
 
 void parser::tokenizer::clear_token_patterns() {
   _patterns.clear();
+  _automaton.reset();
+  _automaton_built = false;
 }
 
 /********************************
@@ -456,14 +670,14 @@ void parser::tokenizer::clear_token_patterns() {
 
 void parser::tokenizer::add_token(unsigned int id, const std::string &value) {
   token result(id, value);
-  result._file = file;
+  set_file(result);
   tokens.push_back(result);
 }
 
 void parser::tokenizer::add_token(unsigned int id, const std::string &value,
                                   std::streampos spos) {
   token result(id, value, spos);
-  result._file = file;
+  set_file(result);
   tokens.push_back(result);
 }
 
@@ -471,29 +685,79 @@ void parser::tokenizer::add_token(unsigned int id, const std::string &value,
                                   std::streampos spos,
                                   std::streamoff soff) {
   token result(id, value, spos, soff);
-  result._file = file;
+  set_file(result);
   tokens.push_back(result);
 }
 
+void parser::tokenizer::add_token(unsigned int id,
+                                  std::string::size_type start,
+                                  std::string::size_type length,
+                                  std::streampos spos,
+                                  std::streamoff soff) {
+  token result(id, buffer().substr(start, length), spos, soff);
+  set_file(result);
+  tokens.push_back(result);
+}
+
+/*******************************
+ * parser::tokenizer::set_file *
+ *******************************/
+
+void parser::tokenizer::set_file(token &value) {
+  // Only go to the table when the file we're reading changes.
+  if (not _file_name or *_file_name != file) _file_name = intern_file(file);
+  value._file = _file_name;
+}
+
 /***************************************
  * parser::tokenizer::parse_next_token *
  ***************************************/
 
 void parser::tokenizer::parse_next_token() {
-  if (not code.empty()) {
-    std::smatch match;
-
-    for (auto &pattern : _patterns) {
-      if (regex_search(code, match, pattern.pattern,
-                       std::regex_constants::match_continuous)) {
-        tokens.push_back(token(pattern.token_id, match.str(), position));
-        code = code.substr(match.length());
-        position += match.length();
+  if (remaining()) {
+    const std::string &text = buffer();
+
+    if (not _automaton_built) {
+      _automaton = automaton::compile(_patterns);
+      _automaton_built = true;
+    }
+
+    if (_automaton) {
+      // All the patterns in a single pass, taking the longest match.
+      unsigned int id = 0;
+      auto length = _automaton->match(text.data() + cursor, remaining(), id);
+      if (length) {
+        add_token(id, cursor, length, position);
+        cursor += length;
+        position += static_cast<std::streamoff>(length);
+        return;
+      }
+    } else {
+      // Fall back to trying each regex in turn, still taking the longest.
+      std::smatch match;
+      const auto start = text.cbegin() + cursor;
+      const token_pat_s *best = nullptr;
+      std::string::size_type length = 0;
+
+      for (auto &pattern : _patterns) {
+        if (regex_search(start, text.cend(), match, pattern.pattern,
+                         std::regex_constants::match_continuous) and
+            static_cast<std::string::size_type>(match.length()) > length) {
+          best = &pattern;
+          length = static_cast<std::string::size_type>(match.length());
+        }
+      }
+
+      if (best) {
+        add_token(best->token_id, cursor, length, position);
+        cursor += length;
+        position += static_cast<std::streamoff>(length);
         return;
       }
     }
 
-    throw syntax_error("Syntax error", token(T_INVALID, code, position));
+    throw syntax_error("Syntax error",
+                       token(T_INVALID, text.substr(cursor), position));
   }
 }
 
@@ -504,11 +768,11 @@ void parser::tokenizer::parse_next_token() {
 void parser::tokenizer::parse_tokens() {
   if (is_more_code()) {
     do {
-      if ((need_more and is_more_code()) or not code.empty()) {
+      if ((need_more and is_more_code()) or remaining()) {
         parse_next_token();
       }
- } while (need_more or not code.empty());
-  } else if (code.empty()) {
+    } while (need_more or remaining());
+  } else if (not remaining()) {
     // Add EOF token
     add_token(T_EOF, "", position);
   }
@@ -548,6 +812,17 @@ void parser::grammer::eval(const std::string &code) {
   }
 }
 
+void parser::grammer::eval(const std::string &code,
+                           const std::string &source) {
+  if (tokens) {
+    tokens->push(code, source);
+    entry();
+    tokens->pop();
+  } else {
+    throw std::runtime_error("parser::grammer tokenizer not set");
+  }
+}
+
 void parser::grammer::eval(std::istream &code, const std::string &source) {
   if (tokens) {
     tokens->push(code, source);
@@ -557,3 +832,14 @@ void parser::grammer::eval(std::istream &code, const std::string &source) {
     throw std::runtime_error("parser::grammer tokenizer not set");
   }
 }
+
+void parser::grammer::eval(std::shared_ptr<const std::string> code,
+                           const std::string &source) {
+  if (tokens) {
+    tokens->push(std::move(code), source);
+    entry();
+    tokens->pop();
+  } else {
+    throw std::runtime_error("parser::grammer tokenizer not set");
+  }
+}
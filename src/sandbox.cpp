@@ -56,141 +56,148 @@ cutlet::variable::pointer
 builtin::sandbox_var::operator()(cutlet::variable::pointer self,
                                  cutlet::interpreter &interp,
                                  const cutlet::list &arguments) {
+  return method(self, interp, cutlet::SEL_NONE, arguments);
+}
+
+/*********************************
+ * builtin::sandbox_var::method *
+ *********************************/
+
+cutlet::variable::pointer
+builtin::sandbox_var::method(cutlet::variable::pointer self,
+                             cutlet::interpreter &interp,
+                             cutlet::selector_t op,
+                             const cutlet::list &arguments) {
   (void)self;
-  const std::string op = *(arguments[0]);
   const size_t args = arguments.size();
 
-  switch (op[0]) {
-  case 'c':
-    if (op == "clear") {
-      // $sandbox clear
-      if (args != 2)
-        throw std::runtime_error("To many arguments to sandbox operator clear");
-
-      _sandbox->clear();
-    }
-    break;
-  case 'e':
-    if (op == "eval") {
-      // $sandbox eval body ...
-      bool first = true;
+  if (op == cutlet::SEL_NONE) op = cutlet::selector(arguments);
 
-      auto cur_frame = interp.frame();
+  switch (op) {
+  case cutlet::SEL_CLEAR:
+    // $sandbox clear
+    if (args != 2)
+      throw std::runtime_error("To many arguments to sandbox operator clear");
 
-      interp.push(_sandbox, "sandbox eval");
-      for (auto &command: arguments) {
-        if (first) {
-          first = false;
-        } else {
-          try {
-            interp(command);
-          } catch (...) {
-            /* If an error was thrown within the sandbox, we pop the
-             * context off the stack to restore the previous environment
-             * then rethrow the exception.
-             */
-            interp.pop(cur_frame);
-            throw;
-          }
-        }
-      }
+    _sandbox->clear();
+    break;
 
-      // Clean up the stack
-     interp.pop(cur_frame);
+  case cutlet::SEL_EVAL: {
+    // $sandbox eval body ...
+    bool first = true;
 
-    } else if (op == "expr") {
-      // $sandbox expr body ...
-      if (args == 2) {
-        variable::pointer result;
+    auto cur_frame = interp.frame();
 
-        auto cur_frame = interp.frame();
-        interp.push(_sandbox, "sandbox expr");
+    interp.push(_sandbox, "sandbox eval");
+    for (auto &command: arguments) {
+      if (first) {
+        first = false;
+      } else {
         try {
-          result = interp.expr(arguments[1]);
+          interp(command);
         } catch (...) {
-          /* If an error was thrown within the sandbox, we pop the context
-           * off the stack to restore the previous environment then
-           * rethrow the exception.
+          /* If an error was thrown within the sandbox, we pop the
+           * context off the stack to restore the previous environment
+           * then rethrow the exception.
            */
           interp.pop(cur_frame);
           throw;
         }
-        interp.pop(cur_frame);
-
-        return result;
-      } else {
-        std::stringstream mesg;
-        mesg << "Invalid number of arguments for $sandbox expr "
-             << " (2 = " << args << ").\n $sandbox expr body";
-        throw std::runtime_error(mesg.str());
-      }
-    }
-    break;
-  case 'g':
-    if (op == "global") {
-      // $sandbox global name ¿=? ¿value?
-      switch (args) {
-      case 2:
-        _sandbox->variable(*(arguments[1]), nullptr);
-        break;
-      case 3:
-        if (*(arguments[1]) == "=")
-          _sandbox->variable(*(arguments[1]), nullptr);
-        else
-          _sandbox->variable(*(arguments[1]), arguments[2]);
-        break;
-      case 4:
-        if (*(arguments[2]) != "=") {
-          throw std::runtime_error("global name ¿=? value\n"
-                                   " Expected = got " +
-                                   cutlet::cast<std::string>(arguments[2]));
-        }
-        _sandbox->variable(*(arguments[1]), arguments[3]);
-        break;
-      default:
-        throw std::runtime_error("Invalid arguments to sandbox operator clear");
       }
     }
+
+    // Clean up the stack
+    interp.pop(cur_frame);
     break;
-  case 'l':
-    if (op == "link") {
-      // $sandbox link component ¿as name?
-      // $sandbox link *args
-      if (args == 4 and *(arguments[2]) == "as") {
-        _sandbox->add(*(arguments[3]),
-                      interp.get(*(arguments[1])));
-      } else {
-        bool first = true;
-        for (auto &parm: arguments) {
-          if (first) first = false;
-          else _sandbox->add(*parm, interp.get(*parm));
-        }
+  }
+
+  case cutlet::SEL_EXPR:
+    // $sandbox expr body ...
+    if (args == 2) {
+      variable::pointer result;
+
+      auto cur_frame = interp.frame();
+      interp.push(_sandbox, "sandbox expr");
+      try {
+        result = interp.expr(arguments[1]);
+      } catch (...) {
+        /* If an error was thrown within the sandbox, we pop the context
+         * off the stack to restore the previous environment then
+         * rethrow the exception.
+         */
+        interp.pop(cur_frame);
+        throw;
       }
+      interp.pop(cur_frame);
+
+      return result;
+    } else {
+      std::stringstream mesg;
+      mesg << "Invalid number of arguments for $sandbox expr "
+           << " (2 = " << args << ").\n $sandbox expr body";
+      throw std::runtime_error(mesg.str());
     }
-    break;
-  case 't':
-    if (op == "type") {
-      // $sandbox type
-      if (args != 2)
-        throw std::runtime_error("To many arguments to sandbox operator type");
 
-      return std::make_shared<cutlet::string>("sandbox");
+  case cutlet::SEL_GLOBAL:
+    // $sandbox global name ¿=? ¿value?
+    switch (args) {
+    case 2:
+      _sandbox->variable(*(arguments[1]), nullptr);
+      break;
+    case 3:
+      if (*(arguments[1]) == "=")
+        _sandbox->variable(*(arguments[1]), nullptr);
+      else
+        _sandbox->variable(*(arguments[1]), arguments[2]);
+      break;
+    case 4:
+      if (*(arguments[2]) != "=") {
+        throw std::runtime_error("global name ¿=? value\n"
+                                 " Expected = got " +
+                                 cutlet::cast<std::string>(arguments[2]));
+      }
+      _sandbox->variable(*(arguments[1]), arguments[3]);
+      break;
+    default:
+      throw std::runtime_error("Invalid arguments to sandbox operator clear");
     }
     break;
-  case 'u':
-    if (op == "unlink") {
-      // $sandbox unlink *args
 
+  case cutlet::SEL_LINK:
+    // $sandbox link component ¿as name?
+    // $sandbox link *args
+    if (args == 4 and *(arguments[2]) == "as") {
+      _sandbox->add(*(arguments[3]),
+                    interp.get(*(arguments[1])));
+    } else {
       bool first = true;
       for (auto &parm: arguments) {
         if (first) first = false;
-        else _sandbox->remove(*parm);
+        else _sandbox->add(*parm, interp.get(*parm));
       }
+    }
+    break;
 
+  case cutlet::SEL_TYPE:
+    // $sandbox type
+    if (args != 2)
+      throw std::runtime_error("To many arguments to sandbox operator type");
+
+    return std::make_shared<cutlet::string>("sandbox");
+
+  case cutlet::SEL_UNLINK: {
+    // $sandbox unlink *args
+    bool first = true;
+    for (auto &parm: arguments) {
+      if (first) first = false;
+      else _sandbox->remove(*parm);
     }
     break;
+  }
+
   default:
-    throw std::runtime_error("Unknown operator \"" + op +
+    throw std::runtime_error("Unknown operator \"" +
+                             static_cast<std::string>(*(arguments[0])) +
                              "\" for sandbox type.");
   }
 
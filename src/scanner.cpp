@@ -0,0 +1,218 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "scanner.h"
+#include <stdexcept>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  using find_t = std::size_t (*)(const char *, std::size_t,
+                                 const cutlet::scanner::byteset &);
+
+  /***************
+   * find_scalar *
+   ***************/
+
+  std::size_t find_scalar(const char *data, std::size_t length,
+                          const cutlet::scanner::byteset &set) {
+    for (std::size_t i = 0; i < length; ++i) {
+      if (set.contains(static_cast<unsigned char>(data[i]))) return i;
+    }
+    return std::string::npos;
+  }
+
+#ifdef SCANNER_X86
+
+  /*************
+   * find_sse2 *
+   *************/
+
+  __attribute__((target("sse2")))
+  std::size_t find_sse2(const char *data, std::size_t length,
+                        const cutlet::scanner::byteset &set) {
+    __m128i needles[cutlet::scanner::byteset::max];
+    const unsigned int count = set.size();
+    for (unsigned int n = 0; n < count; ++n)
+      needles[n] = _mm_set1_epi8(static_cast<char>(set[n]));
+
+    // Compare 16 bytes at a time against every byte in the set.
+    std::size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      __m128i hits = _mm_cmpeq_epi8(chunk, needles[0]);
+      for (unsigned int n = 1; n < count; ++n)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, needles[n]));
+
+      const int mask = _mm_movemask_epi8(hits);
+      if (mask) return i + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+
+    // Finish off the tail.
+    std::size_t result = find_scalar(data + i, length - i, set);
+    return (result == std::string::npos ? result : result + i);
+  }
+
+  /*************
+   * find_avx2 *
+   *************/
+
+  __attribute__((target("avx2")))
+  std::size_t find_avx2(const char *data, std::size_t length,
+                        const cutlet::scanner::byteset &set) {
+    __m256i needles[cutlet::scanner::byteset::max];
+    const unsigned int count = set.size();
+    for (unsigned int n = 0; n < count; ++n)
+      needles[n] = _mm256_set1_epi8(static_cast<char>(set[n]));
+
+    // Compare 32 bytes at a time against every byte in the set.
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+      const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+      __m256i hits = _mm256_cmpeq_epi8(chunk, needles[0]);
+      for (unsigned int n = 1; n < count; ++n)
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, needles[n]));
+
+      const unsigned int mask =
+        static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+      if (mask) return i + static_cast<std::size_t>(__builtin_ctz(mask));
+    }
+
+    // Less than 32 bytes left, let SSE2 finish off the tail.
+    std::size_t result = find_sse2(data + i, length - i, set);
+    return (result == std::string::npos ? result : result + i);
+  }
+
+#endif /* SCANNER_X86 */
+
+  /***********
+   * resolve *
+   ***********/
+
+  /** Pick the best implementation the CPU we're running on supports.
+   */
+  find_t resolve(const char *&name) {
+#ifdef SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      name = "avx2";
+      return find_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+      name = "sse2";
+      return find_sse2;
+    }
+#endif
+    name = "scalar";
+    return find_scalar;
+  }
+
+  const char *implementation_name = nullptr;
+
+  find_t find_impl() {
+    static const find_t impl = resolve(implementation_name);
+    return impl;
+  }
+
+  const cutlet::scanner::byteset braces = {'{', '}'};
+}
+
+/******************************************************************************
+ * class cutlet::scanner::byteset
+ */
+
+/*************************************
+ * cutlet::scanner::byteset::byteset *
+ *************************************/
+
+cutlet::scanner::byteset::byteset(std::initializer_list<unsigned char> bytes)
+  : _count(0), _table() {
+  if (bytes.size() == 0 or bytes.size() > max)
+    throw std::length_error("Invalid number of bytes for a scanner byteset");
+
+  for (auto value: bytes) {
+    _bytes[_count++] = value;
+    _table[value] = true;
+  }
+}
+
+/******************************************************************************
+ * namespace cutlet::scanner
+ */
+
+/*************************
+ * cutlet::scanner::find *
+ *************************/
+
+std::size_t cutlet::scanner::find(const char *data, std::size_t length,
+                                  const byteset &set) {
+  return find_impl()(data, length, set);
+}
+
+/***********************************
+ * cutlet::scanner::find_block_end *
+ ***********************************/
+
+std::size_t cutlet::scanner::find_block_end(const char *data,
+                                            std::size_t length,
+                                            unsigned int &depth) {
+  const find_t impl = find_impl();
+  std::size_t offset = 0;
+
+  while (offset < length) {
+    std::size_t found = impl(data + offset, length - offset, braces);
+    if (found == std::string::npos) break;
+
+    offset += found;
+    if (data[offset] == '{') {
+      ++depth;
+    } else if (--depth == 0) {
+      return offset;
+    }
+    ++offset;
+  }
+
+  return std::string::npos;
+}
+
+/***********************************
+ * cutlet::scanner::implementation *
+ ***********************************/
+
+const char *cutlet::scanner::implementation() {
+  find_impl();
+  return implementation_name;
+}
@@ -0,0 +1,86 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+
+#ifndef _CUTLET_SCANNER_H
+#define _CUTLET_SCANNER_H
+
+namespace cutlet {
+  namespace scanner {
+
+    /** A small set of bytes to search for, such as the structural
+     * characters of a block or string.
+     */
+    class byteset {
+    public:
+      static const unsigned int max = 12;
+
+      byteset(std::initializer_list<unsigned char> bytes);
+
+      bool contains(unsigned char value) const { return _table[value]; }
+
+      unsigned int size() const { return _count; }
+      unsigned char operator [](unsigned int index) const {
+        return _bytes[index];
+      }
+
+    private:
+      unsigned char _bytes[max];
+      unsigned int _count;
+      bool _table[256];
+    };
+
+    /** Find the first byte in data that is in the set.
+     * @return The offset of the byte or std::string::npos if there isn't
+     *         one.
+     */
+    std::size_t find(const char *data, std::size_t length,
+                     const byteset &set);
+
+    /** Find the } that closes a block, skipping any nested blocks.
+     * @param depth The current nesting depth, which is updated as the
+     *        braces are found. A depth of 1 is inside the outer block.
+     * @return The offset of the closing } or std::string::npos if the
+     *         block doesn't end within data.
+     */
+    std::size_t find_block_end(const char *data, std::size_t length,
+                               unsigned int &depth);
+
+    /** The name of the implementation picked for this CPU, ie. avx2, sse2
+     * or scalar.
+     */
+    const char *implementation();
+  }
+}
+
+#endif /* _CUTLET_SCANNER_H */
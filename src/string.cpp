@@ -46,7 +46,7 @@ namespace {
   size_t str_len(const std::string &value) {
     size_t count = 0;
     cutlet::utf8::iterator it(value);
-    for (; it != it.end(); count++, it++);
+    for (; it != it.end(); count++, ++it);
 
     return count;
   }
@@ -97,10 +97,10 @@ namespace {
     cutlet::utf8::iterator it(value);
     while (index and it != it.end()) {
       index--;
-      it++;
+      ++it;
     }
 
-    return *it;
+    return std::string(it.view());
   }
 
 
@@ -192,7 +192,7 @@ namespace {
 
       auto result(self);
       cutlet::utf8::iterator it(result);
-      for (; idx > 0; it++, idx--);
+      for (; idx > 0; ++it, idx--);
       result.insert(it.position(), value);
 
       return cutlet::var<cutlet::string>(result);
@@ -220,7 +220,7 @@ namespace {
     auto result(self);
     cutlet::utf8::iterator it(result);
 
-    for (; idx > 0; it++, idx--);
+    for (; idx > 0; ++it, idx--);
 
     result.insert(it.position(), *(arguments[2]));
 
@@ -270,8 +270,8 @@ namespace {
     cutlet::utf8::iterator start_it(self);
     cutlet::utf8::iterator end_it(self);
 
-    for (; start > 0; start_it++, start--);
-    for (; end > 0; end_it++, end--);
+    for (; start > 0; ++start_it, start--);
+    for (; end > 0; ++end_it, end--);
 
     return cutlet::var<cutlet::string>(
       cutlet::utf8::substr(start_it, end_it));
@@ -307,164 +307,145 @@ cutlet::string::~string() noexcept {}
 cutlet::variable::pointer cutlet::string::operator()(variable::pointer self,
                                                      interpreter &interp,
                                                      const list &arguments) {
+  return _operator(self, interp, SEL_NONE, arguments, false);
+}
+
+/**************************
+ * cutlet::string::method *
+ **************************/
+
+cutlet::variable::pointer cutlet::string::method(variable::pointer self,
+                                                 interpreter &interp,
+                                                 selector_t op,
+                                                 const list &arguments) {
+  return _operator(self, interp, op, arguments, true);
+}
+
+/*****************************
+ * cutlet::string::_operator *
+ *****************************/
+
+cutlet::variable::pointer
+cutlet::string::_operator(variable::pointer self, interpreter &interp,
+                          selector_t op, const list &arguments,
+                          bool fallback) {
   size_t args = arguments.size();
 
   /* TODO
    *  - rfind
    */
   if (args) {
-    std::string op = *(arguments[0]);
-    // We use a switch here to make the operator look up a bit faster.
-    switch (op[0]) {
-    case '=':
-      if (op == "==" or op == "=") {
-        // $string == other or $string = other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator =="));
-        return (*this == cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-      }
-      break;
-    case '!':
-      if (op == "!=") {
-        // $string <> other or $string != other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator !="));
-        return (*this != cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-      }
-      break;
-    case '<':
-      if (op == "<>") {
-        // $string <> other or $string != other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator <>"));
-        return (*this != cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-
-      } else if (op == "<") {
-        // $string < other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator <"));
-        return (*this < cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-
-      } else if (op == "<=") {
-        // $string <= other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator <="));
-        return (*this <= cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-      }
-      break;
-    case '>':
-      if (op == ">") {
-        // $string > other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator >"));
-        return (*this > cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-
-      } else if (op == ">=") {
-        // $string >= other
-        if (args != 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator >="));
-        return (*this >= cutlet::cast<std::string>(arguments[1])
-                ? cutlet::var<cutlet::boolean>(true)
-                : cutlet::var<cutlet::boolean>(false));
-      }
-      break;
-    case '+':
-      if (op == "+") {
-        // $string + *args
-        if (args < 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator +"));
-        cutlet::list sargs(arguments);
-        sargs.pop_front(); // Remove the operator.
-
-        return cutlet::var<cutlet::string>(*this + sargs.join());
-
+    if (op == SEL_NONE) op = selector(arguments);
+    switch (op) {
+    case SEL_EQUAL:
+      // $string == other or $string = other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator =="));
+      return (*this == cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_NOT_EQUAL:
+      // $string <> other or $string != other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator !="));
+      return (*this != cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_LESS:
+      // $string < other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator <"));
+      return (*this < cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_LESS_EQUAL:
+      // $string <= other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator <="));
+      return (*this <= cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_GREATER:
+      // $string > other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator >"));
+      return (*this > cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_GREATER_EQUAL:
+      // $string >= other
+      if (args != 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator >="));
+      return (*this >= cutlet::cast<std::string>(arguments[1])
+              ? cutlet::var<cutlet::boolean>(true)
+              : cutlet::var<cutlet::boolean>(false));
+
+    case SEL_PLUS:
+    case SEL_APPEND: {
+      // $string + *args or $string append *args
+      if (args < 2)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator ") +
+                                 (op == SEL_PLUS ? "+" : "append"));
+      cutlet::list sargs(arguments);
+      sargs.pop_front(); // Remove the operator.
+
+      return cutlet::var<cutlet::string>(*this + sargs.join());
+    }
 
-      }
-      break;
-    case 'a':
-      if (op == "append") {
-        // $string append *args
-        if (args < 2)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator append"));
-        cutlet::list sargs(arguments);
-        sargs.pop_front(); // Remove the operator.
-
-        return cutlet::var<cutlet::string>(*this + sargs.join());
-      }
-      break;
-    case 'e':
-      if (op == "endswith") {
-        // $string endswith value
-        return _endswith(*this, interp, arguments);
-      }
-      break;
-    case 'f':
-      if (op == "find") {
-        // $string find value
-        return _find(*this, interp, arguments);
-      }
-      break;
-    case 'i':
-      if (op == "index") {
-        // $string index offset ¿¿=? value?
-        return _index(*this, interp, arguments);
-
-      } else if (op == "insert") {
-        // $string insert offset value
-        return _insert(*this, interp, arguments);
-      }
-      break;
-    case 'l':
-      if (op == "length") {
-        // $string length
-        if (args != 1)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator length"));
-        return cutlet::var<cutlet::string>(str_len(*this));
-      }
-      break;
-    case 's':
-      if (op == "startswith") {
-        // $string startswith value
-        return _startswith(*this, interp, arguments);
-
-      } else if (op == "substr") {
-        // $string substr start end
-        return _substr(*this, interp, arguments);
-      }
-      break;
-    case 't':
-      if (op == "type") {
-        // $string type
-        if (args != 1)
-          throw std::runtime_error(std::string("Invalid number of arguments to "
-                                               "string operator type"));
-        return cutlet::var<cutlet::string>("string");
-      }
-      break;
+    case SEL_ENDSWITH:
+      // $string endswith value
+      return _endswith(*this, interp, arguments);
+
+    case SEL_FIND:
+      // $string find value
+      return _find(*this, interp, arguments);
+
+    case SEL_INDEX:
+      // $string index offset ¿¿=? value?
+      return _index(*this, interp, arguments);
+
+    case SEL_INSERT:
+      // $string insert offset value
+      return _insert(*this, interp, arguments);
+
+    case SEL_LENGTH:
+      // $string length
+      if (args != 1)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator length"));
+      return cutlet::var<cutlet::string>(str_len(*this));
+
+    case SEL_STARTSWITH:
+      // $string startswith value
+      return _startswith(*this, interp, arguments);
+
+    case SEL_SUBSTR:
+      // $string substr start end
+      return _substr(*this, interp, arguments);
+
+    case SEL_TYPE:
+      // $string type
+      if (args != 1)
+        throw std::runtime_error(std::string("Invalid number of arguments to "
+                                             "string operator type"));
+      return cutlet::var<cutlet::string>("string");
     }
   }
+  // Not one of ours, but a subclass may have added it to operator().
+  if (fallback) return (*this)(self, interp, arguments);
+
   // Pass through
   return variable::operator()(self, interp, arguments);
 }
@@ -0,0 +1,430 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "transpiler.h"
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+  /* The start of every generated library, the helpers its functions share.
+   */
+  const char *const prologue =
+    "#include <cutlet>\n"
+    "\n"
+    "namespace {\n"
+    "  using pointer = cutlet::variable::pointer;\n"
+    "\n"
+    "  [[noreturn]] void error(const std::exception &err, "
+    "const char *where) {\n"
+    "    throw cutlet::exception(std::string(where) + \": \" + err.what());\n"
+    "  }\n"
+    "\n"
+    "  pointer variable(cutlet::interpreter &interp, const std::string &name,\n"
+    "                   cutlet::frame::slot_cache_t &slot) {\n"
+    "    try {\n"
+    "      return interp.var(name, slot);\n"
+    "    } catch (const cutlet::exception &) {\n"
+    "      throw;\n"
+    "    } catch (const std::exception &err) {\n"
+    "      throw cutlet::exception(err.what());\n"
+    "    }\n"
+    "  }\n"
+    "\n"
+    "  void append(cutlet::string &result, const pointer &value) {\n"
+    "    if (value) result += static_cast<std::string>(*value);\n"
+    "  }\n";
+
+  /* The end of a command's function, errors get the command's position
+   * like they do from the command nodes.
+   */
+  void catch_errors(std::ostream &out, const std::string &where) {
+    out << "    } catch (const cutlet::exception &) {\n"
+        << "      throw;\n"
+        << "    } catch (const std::exception &err) {\n"
+        << "      error(err, " << where << ");\n"
+        << "    }\n"
+        << "  }\n";
+  }
+}
+
+/******************************************************************************
+ * class cutlet::ast::transpiler
+ */
+
+/***************************************
+ * cutlet::ast::transpiler::transpiler *
+ ***************************************/
+
+cutlet::ast::transpiler::transpiler(std::ostream &out, compile_t compile)
+  : _out(out), _compile(compile) {}
+
+/****************************************
+ * cutlet::ast::transpiler::operator () *
+ ****************************************/
+
+void cutlet::ast::transpiler::operator()(block &tree,
+                                         const std::string &source) {
+  std::string entry = emit(tree);
+
+  _out << "/* Generated by cutlet --emit-cpp from\n * " << source
+       << "\n * Any changes made here will be lost.\n */\n\n"
+       << prologue << "\n";
+
+  // The constants are built once, when the library is loaded.
+  std::vector<const std::string *> texts(_texts.size());
+  for (auto &text: _texts) texts[text.second] = &text.first;
+  for (unsigned int index = 0; index < texts.size(); ++index) {
+    _out << "  const std::string text_" << index << "("
+         << quote(*texts[index]);
+    if (texts[index]->find('\0') != std::string::npos)
+      _out << ", " << texts[index]->size();
+    _out << ");\n";
+  }
+
+  std::vector<const std::string *> literals(_literals.size());
+  for (auto &literal: _literals) literals[literal.second] = &literal.first;
+  for (unsigned int index = 0; index < literals.size(); ++index) {
+    _out << "  const pointer literal_" << index
+         << " = cutlet::var<cutlet::string>(text_"
+         << _texts.at(*literals[index]) << ");\n";
+  }
+  for (unsigned int slot = 0; slot < _slots.size(); ++slot) {
+    _out << "  cutlet::frame::slot_cache_t slot_" << slot << "("
+         << _slots[slot] << ");\n";
+  }
+
+  _out << "\n" << _declarations.str() << _definitions.str() << "}\n\n"
+       << "extern \"C\" {\n"
+       << "  DECLSPEC void init_cutlet(cutlet::interpreter *interp);\n"
+       << "}\n\n"
+       << "void init_cutlet(cutlet::interpreter *interp) {\n"
+       << "  " << entry << "(*interp);\n"
+       << "}\n";
+}
+
+/*********************************
+ * cutlet::ast::transpiler::emit *
+ *********************************/
+
+std::string cutlet::ast::transpiler::emit(block &tree) {
+  std::string name = function("block");
+  std::ostringstream out;
+
+  std::list<std::string> statements;
+  for (auto &n: tree._nodes) {
+    if (n and not dynamic_cast<comment *>(n.get()))
+      statements.push_back(value(*n));
+  }
+
+  _declarations << "  void " << name << "(cutlet::interpreter &interp);\n";
+
+  out << "\n  void " << name << "(cutlet::interpreter &interp) {\n";
+  if (statements.size() > 1)
+    out << "    cutlet::frame &frame = *interp.frame();\n";
+  for (auto it = statements.begin(); it != statements.end(); ++it) {
+    if (it != statements.begin())
+      out << "    if (frame.state() != cutlet::frame::FS_RUNNING) return;\n";
+    out << "    " << *it << ";\n";
+  }
+  if (statements.empty()) out << "    (void)interp;\n";
+  out << "  }\n";
+
+  _definitions << out.str();
+  return name;
+}
+
+std::string
+cutlet::ast::transpiler::emit(node &n, node &fn, unsigned int function_id,
+                              const std::list<node::pointer> &parameters,
+                              bool expression) {
+  /* def with its body in a block gets the body compiled too, as long as
+   * def is still the builtin one when the library runs.
+   */
+  std::string body;
+  if (not expression and function_id == cutlet::A_VALUE and
+      fn.body() == "def" and
+      (parameters.size() == 2 or parameters.size() == 3)) {
+    auto last = dynamic_cast<ast::value *>(parameters.back().get());
+    if (last and last->token() == cutlet::T_BLOCK) {
+      auto tree = _compile(last->token());
+      if (tree) body = emit(*tree);
+    }
+  }
+
+  std::string name = function(expression ? "expression" : "command");
+
+  // The parameters are worked out before the command's function is written.
+  std::string callee;
+  if (expression or function_id != cutlet::A_VALUE)
+    callee = value(fn);
+  else
+    callee = text(fn.body());
+  std::list<std::string> args;
+  for (auto &parameter: parameters) args.push_back(value(*parameter));
+
+  _declarations << "  pointer " << name << "(cutlet::interpreter &interp);\n";
+
+  std::ostringstream out;
+  out << "\n  // " << n.file() << ":" << n.position() << "\n"
+      << "  pointer " << name << "(cutlet::interpreter &interp) {\n";
+  if (function_id == cutlet::A_VALUE and not expression)
+    out << "    static cutlet::sandbox::call_cache_t cache;\n";
+  else
+    out << "    pointer function = " << callee << ";\n";
+
+  // Variables are called with the operator interned when the library loads.
+  std::string op = "cutlet::SEL_NONE";
+  if (function_id != cutlet::A_VALUE and not parameters.empty() and
+      parameters.front()->id() == cutlet::A_VALUE) {
+    op = "op";
+    out << "    static const cutlet::selector_t op = cutlet::selector("
+        << text(parameters.front()->body()) << ");\n";
+  }
+  out << "    cutlet::interpreter::arguments args(interp);\n";
+  for (auto &arg: args) out << "    args->push_back(" << arg << ");\n";
+  out << "\n    try {\n";
+
+  if (expression) {
+    out << "      if (args->empty()) return function;\n";
+    if (function_id == cutlet::A_VALUE) {
+      out << "      static cutlet::sandbox::call_cache_t cache;\n"
+          << "      return interp.call(cutlet::cast<std::string>(function), "
+          << "*args, cache);\n";
+    } else {
+      out << "      return function->method(function, interp, " << op
+          << ", *args);\n";
+    }
+
+  } else if (not body.empty()) {
+    out << "      return interp.def(*args, " << body << ", cache);\n";
+
+  } else if (function_id == cutlet::A_VALUE) {
+    out << "      return interp.call(" << callee << ", *args, cache);\n";
+
+  } else if (function_id == cutlet::A_STRING) {
+    out << "      return function->method(function, interp, " << op
+        << ", *args);\n";
+
+  } else {
+    out << "      if (not args->empty())\n"
+        << "        return function->method(function, interp, " << op
+        << ", *args);\n"
+        << "      return interp.call(cutlet::cast<std::string>(function), "
+        << "*args);\n";
+  }
+  catch_errors(out, where(n));
+
+  _definitions << out.str();
+  return name;
+}
+
+/**************************************
+ * cutlet::ast::transpiler::emit_tail *
+ **************************************/
+
+/** return [f ...], where the call to f may be left for the def function
+ * being returned from to make.
+ */
+std::string cutlet::ast::transpiler::emit_tail(command &cmd) {
+  auto &call = static_cast<command &>(*cmd._parameters.front());
+
+  std::string name = function("command");
+  std::string callee = text(call._function->body());
+  std::string ret = text(cmd._function->body());
+  std::list<std::string> args;
+  for (auto &parameter: call._parameters) args.push_back(value(*parameter));
+
+  _declarations << "  pointer " << name << "(cutlet::interpreter &interp);\n";
+
+  std::ostringstream out;
+  out << "\n  // " << cmd.file() << ":" << cmd.position() << "\n"
+      << "  pointer " << name << "(cutlet::interpreter &interp) {\n"
+      << "    static cutlet::sandbox::call_cache_t cache, return_cache;\n"
+      << "    cutlet::interpreter::arguments args(interp);\n";
+  for (auto &arg: args) out << "    args->push_back(" << arg << ");\n";
+  out << "\n    try {\n"
+      << "      if (interp.return_call(" << callee << ", *args)) "
+      << "return nullptr;\n"
+      << "      cutlet::interpreter::arguments value(interp);\n"
+      << "      value->push_back(interp.call(" << callee
+      << ", *args, cache));\n"
+      << "      return interp.call(" << ret << ", *value, return_cache);\n";
+  catch_errors(out, where(cmd));
+
+  _definitions << out.str();
+  return name;
+}
+
+std::string cutlet::ast::transpiler::emit(string &str) {
+  // Literal parts next to each other are joined.
+  std::list<string::_parts_s> parts;
+  for (auto &part: str._stringy) {
+    if (not part.n and not parts.empty() and not parts.back().n)
+      parts.back().s += part.s;
+    else
+      parts.push_back(part);
+  }
+
+  // Nothing to substitute, the string is a constant.
+  if (parts.empty()) return literal("");
+  if (parts.size() == 1 and not parts.front().n)
+    return literal(parts.front().s);
+
+  std::list<std::string> pieces;
+  for (auto &part: parts) {
+    if (part.n)
+      pieces.push_back("append(result, " + value(*part.n) + ")");
+    else
+      pieces.push_back("result += " + text(part.s));
+  }
+
+  std::string name = function("string");
+  _declarations << "  pointer " << name << "(cutlet::interpreter &interp);\n";
+
+  std::ostringstream out;
+  out << "\n  pointer " << name << "(cutlet::interpreter &interp) {\n"
+      << "    cutlet::string result;\n";
+  for (auto &piece: pieces) out << "    " << piece << ";\n";
+  out << "    return cutlet::var<cutlet::string>(result);\n"
+      << "  }\n";
+
+  _definitions << out.str();
+  return name + "(interp)";
+}
+
+/**********************************
+ * cutlet::ast::transpiler::value *
+ **********************************/
+
+/** The C++ expression for the value of a node.
+ */
+std::string cutlet::ast::transpiler::value(node &n) {
+  if (auto cmd = dynamic_cast<command *>(&n)) {
+    if (cmd->_tail) return emit_tail(*cmd) + "(interp)";
+    return emit(n, *cmd->_function, cmd->_function_id, cmd->_parameters,
+                false) + "(interp)";
+
+  } else if (auto expr = dynamic_cast<expression *>(&n)) {
+    return emit(n, *expr->_function, expr->_function_id, expr->_parameters,
+                true) + "(interp)";
+
+  } else if (auto str = dynamic_cast<string *>(&n)) {
+    return emit(*str);
+
+  } else if (dynamic_cast<variable *>(&n)) {
+    _slots.push_back(text(n.body()));
+    return "variable(interp, " + _slots.back() + ", slot_" +
+      std::to_string(_slots.size() - 1) + ")";
+
+  } else if (dynamic_cast<ast::value *>(&n)) {
+    return literal(n.body());
+  }
+
+  std::stringstream msg;
+  msg << n.file() << ":" << n.position() << ": Unable to emit C++ for node "
+      << n.id();
+  throw std::runtime_error(msg.str());
+}
+
+/*********************************
+ * cutlet::ast::transpiler::text *
+ *********************************/
+
+std::string cutlet::ast::transpiler::text(const std::string &value) {
+  auto it = _texts.find(value);
+  if (it == _texts.end())
+    it = _texts.emplace(value, static_cast<unsigned int>(_texts.size())).first;
+  return "text_" + std::to_string(it->second);
+}
+
+/************************************
+ * cutlet::ast::transpiler::literal *
+ ************************************/
+
+std::string cutlet::ast::transpiler::literal(const std::string &value) {
+  text(value);
+  auto it = _literals.find(value);
+  if (it == _literals.end())
+    it = _literals.emplace(value,
+                           static_cast<unsigned int>(_literals.size())).first;
+  return "literal_" + std::to_string(it->second);
+}
+
+/*************************************
+ * cutlet::ast::transpiler::function *
+ *************************************/
+
+std::string cutlet::ast::transpiler::function(const std::string &type) {
+  return type + "_" + std::to_string(_functions++);
+}
+
+/**********************************
+ * cutlet::ast::transpiler::quote *
+ **********************************/
+
+/** value as a C++ string literal.
+ */
+std::string cutlet::ast::transpiler::quote(const std::string &value) {
+  static const char digits[] = "01234567";
+
+  std::string result("\"");
+  for (unsigned char ch: value) {
+    switch (ch) {
+    case '"':  result += "\\\""; break;
+    case '\\': result += "\\\\"; break;
+    case '\n': result += "\\n"; break;
+    case '\t': result += "\\t"; break;
+    default:
+      if (ch < 0x20 or ch == 0x7f) {
+        // Always three digits, so a digit following can't be taken in.
+        result += '\\';
+        result += digits[(ch >> 6) & 7];
+        result += digits[(ch >> 3) & 7];
+        result += digits[ch & 7];
+      } else {
+        result += static_cast<char>(ch);
+      }
+    }
+  }
+  return result + "\"";
+}
+
+/**********************************
+ * cutlet::ast::transpiler::where *
+ **********************************/
+
+/** Where a node is in the script, as a C++ string literal.
+ */
+std::string cutlet::ast::transpiler::where(const node &n) {
+  std::stringstream result;
+  result << n.file() << ":" << n.position();
+  return quote(result.str());
+}
@@ -0,0 +1,91 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ast.h"
+#include <functional>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#ifndef _CUTLET_TRANSPILER_H
+#define _CUTLET_TRANSPILER_H
+
+namespace cutlet {
+  namespace ast {
+
+    /** Writes a compiled script out as C++ source for a native library,
+     * with an init_cutlet entry point that runs the script. Every block
+     * becomes a function and every command a function that makes the call
+     * the same way the command node would, with the components looked up
+     * through a call cache of its own. The bodies of functions made with
+     * def are compiled the same way and given to interpreter::def.
+     */
+    class transpiler {
+    public:
+      // Compiles the body of a def function.
+      using compile_t =
+        std::function<std::shared_ptr<block>(const parser::token &)>;
+
+      transpiler(std::ostream &out, compile_t compile);
+
+      void operator()(block &tree, const std::string &source);
+
+    private:
+      std::ostream &_out;
+      compile_t _compile;
+
+      std::ostringstream _declarations;
+      std::ostringstream _definitions;
+      unsigned int _functions = 0;
+
+      // Constants, named by their index.
+      std::map<std::string, unsigned int> _texts;
+      std::map<std::string, unsigned int> _literals;
+      std::vector<std::string> _slots; // The text each slot cache names.
+
+      std::string emit(block &tree);
+      std::string emit(node &n, node &fn, unsigned int function_id,
+                       const std::list<node::pointer> &parameters,
+                       bool expression);
+      std::string emit_tail(command &cmd);
+      std::string emit(string &str);
+
+      std::string value(node &n);
+      std::string text(const std::string &value);
+      std::string literal(const std::string &value);
+      std::string function(const std::string &type);
+
+      static std::string quote(const std::string &value);
+      static std::string where(const node &n);
+    };
+  }
+}
+
+#endif /* _CUTLET_TRANSPILER_H */
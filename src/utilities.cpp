@@ -31,6 +31,9 @@
 #include "utilities.h"
 #include <unistd.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
 #include <libcutlet/utilities>
 
 /***********
@@ -41,588 +44,289 @@ bool fexists(const std::string &filename) {
   return (access(filename.c_str(), F_OK) == 0);
 }
 
-/************
- * is_space *
- ************/
-
-bool is_space(const std::string &value) {
-  if (value == "\u0020") return true;  // SPACE
-  if (value == "\u0009") return true;  // CHARACTER TABULATION (tab)
-
-  if (value == "\u00a0") return true; // NO-BREAK SPACE
-  if (value == "\u2000") return true; // EN QUAD
-  if (value == "\u2001") return true; // EM QUAD
-  if (value == "\u2002") return true; // EN SPACE (nut)
-  if (value == "\u2003") return true; // EM SPACE (mutton)
-  if (value == "\u2004") return true; // THREE-PER-EM SPACE (thick space)
-  if (value == "\u2005") return true; // FOUR-PER-EM SPACE (mid space)
-  if (value == "\u2006") return true; // SIX-PER-EM SPACE
-  if (value == "\u2007") return true; // FIGURE SPACE
-  if (value == "\u2008") return true; // PUNCTUATION SPACE
-  if (value == "\u2009") return true; // THIN SPACE
-  if (value == "\u200a") return true; // HAIR SPACE
-
-  if (value == "\u202f") return true; // NARROW NO-BREAK SPACE
-  if (value == "\u205f") return true; // MEDIUM MATHEMATICAL SPACE
-
-  if (value == "\u3000") return true; // IDEOGRAPHIC SPACE
-  return false;
-}
-
 /**********
- * is_eol *
+ * fnewer *
  **********/
 
-bool is_eol(const std::string &value) {
-  // Check for all of the unicode end of line characters.
-  if (value == "\u000a")       return true; // LF \n
-  if (value == "\u000b")       return true; // VT \v
-  if (value == "\u000c")       return true; // FF \f
-  if (value == "\u000d\u000a") return true; // CR LF \r\n
-  if (value == "\u000d")       return true; // CR \r
-  if (value == "\u0085")       return true; // NEL
-  if (value == "\u2028")       return true; // LS
-  if (value == "\u2029")       return true; // PS
-  return false;
-}
-
-std::string env(const std::string &name) {
-  const char *value = getenv(name.c_str());
-  if (value == nullptr) return "";
-  return value;
+bool fnewer(const std::string &filename, const std::string &other) {
+  struct stat file_stat, other_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) return false;
+  if (stat(other.c_str(), &other_stat) != 0) return true;
+  return file_stat.st_mtime > other_stat.st_mtime;
 }
 
-/*static bool is_numeric(const std::string &value) {
-  switch (value[0]) {
-  case '\xe0':
-    // Devavagari Digits U+0966 - U+096F
-    if (value >= "\u0966" and value <= "\u096f") return true;
-
-    // Bengali Digits U+09E6 - U+09EF
-    if (value >= "\u09e6" and value <= "\u09ef") return true;
-
-    // Gurmukhi Digits U+0A66 - U+0A6F
-    if (value >= "\u0a66" and value <= "\u0a6f") return true;
-
-    // Gujarati Digits U+0AE6 - U+0AEF
-    if (value >= "\u0ae6" and value <= "\u0aef") return true;
-
-    // Oriya Digits U+0B66 - U+0B6F
-    if (value >= "\u0b66" and value <= "\u0b6f") return true;
-
-    // Tamil Digits U+0BE6 - U+0BEF
-    if (value >= "\u0be6" and value <= "\u0bef") return true;
-
-    // Telugu Digits U+0C66 - U+0C6F
-    if (value >= "\u0c66" and value <= "\u0c6f") return true;
-
-    // Kannada Digits U+0CE6 - U+0CEF
-    if (value >= "\u0ce6" and value <= "\u0cef") return true;
-
-    // Malayalam Digits U+0D66 - U+0D6F
-    if (value >= "\u0d66" and value <= "\u0d6f") return true;
-
-    // Sinhala Digits U+0DE6 - U+0DEF
-    if (value >= "\u0de6" and value <= "\u0def") return true;
+namespace {
+
+  /* The ranges of characters we classify. Everything else is CC_OTHER.
+   */
+  struct char_range_s {
+    char32_t first, last;
+    unsigned char cclass;
+  };
+
+  constexpr char_range_s char_ranges[] = {
+    // White space.
+    {0x0020, 0x0020, CC_SPACE},  // SPACE
+    {0x0009, 0x0009, CC_SPACE},  // CHARACTER TABULATION (tab)
+    {0x00a0, 0x00a0, CC_SPACE},  // NO-BREAK SPACE
+    {0x2000, 0x200a, CC_SPACE},  // EN QUAD - HAIR SPACE
+    {0x202f, 0x202f, CC_SPACE},  // NARROW NO-BREAK SPACE
+    {0x205f, 0x205f, CC_SPACE},  // MEDIUM MATHEMATICAL SPACE
+    {0x3000, 0x3000, CC_SPACE},  // IDEOGRAPHIC SPACE
+
+    // End of lines.
+    {0x000a, 0x000d, CC_EOL},    // LF, VT, FF, CR
+    {0x0085, 0x0085, CC_EOL},    // NEL
+    {0x2028, 0x2029, CC_EOL},    // LS, PS
+
+    // Decimal digits.
+    {0x0030, 0x0039, CC_DIGIT},  // Digits
+    {0x0660, 0x0669, CC_DIGIT},  // Arabic-Indic Digits
+    {0x06f0, 0x06f9, CC_DIGIT},  // Extended Arabic-Indic Digits
+    {0x07c0, 0x07c9, CC_DIGIT},  // NKo Digits
+    {0x0966, 0x096f, CC_DIGIT},  // Devavagari Digits
+    {0x09e6, 0x09ef, CC_DIGIT},  // Bengali Digits
+    {0x0a66, 0x0a6f, CC_DIGIT},  // Gurmukhi Digits
+    {0x0ae6, 0x0aef, CC_DIGIT},  // Gujarati Digits
+    {0x0b66, 0x0b6f, CC_DIGIT},  // Oriya Digits
+    {0x0be6, 0x0bef, CC_DIGIT},  // Tamil Digits
+    {0x0c66, 0x0c6f, CC_DIGIT},  // Telugu Digits
+    {0x0ce6, 0x0cef, CC_DIGIT},  // Kannada Digits
+    {0x0d66, 0x0d6f, CC_DIGIT},  // Malayalam Digits
+    {0x0de6, 0x0def, CC_DIGIT},  // Sinhala Digits
+    {0x0e50, 0x0e59, CC_DIGIT},  // Thai Digits
+    {0x0ed0, 0x0ed9, CC_DIGIT},  // Lao Digits
+    {0x0f20, 0x0f29, CC_DIGIT},  // Tibetan Digits
+    {0x1040, 0x1049, CC_DIGIT},  // Myanmar Digits
+    {0x1090, 0x1099, CC_DIGIT},  // Myanmar Shan Digits
+    {0x17e0, 0x17e9, CC_DIGIT},  // Khmer Digits
+    {0x1810, 0x1819, CC_DIGIT},  // Mongolian Digits
+    {0x1946, 0x194f, CC_DIGIT},  // Limbu Digits
+    {0x19d0, 0x19d9, CC_DIGIT},  // New Tai Lue Digits
+    {0x1a80, 0x1a89, CC_DIGIT},  // Tai Tham Hora Digits
+    {0x1a90, 0x1a99, CC_DIGIT},  // Tai Tham Tham Digits
+    {0x1b50, 0x1b59, CC_DIGIT},  // Balinese Digits
+    {0x1bb0, 0x1bb9, CC_DIGIT},  // Sundanese Digits
+    {0x1c40, 0x1c49, CC_DIGIT},  // Lepcha Digits
+    {0x1c50, 0x1c59, CC_DIGIT},  // Ol Chiki Digits
+    {0xa620, 0xa629, CC_DIGIT},  // Vai Digits
+    {0xa8d0, 0xa8d9, CC_DIGIT},  // Saurashtra Digits
+    {0xa900, 0xa909, CC_DIGIT},  // Kayah Li Digits
+    {0xa9d0, 0xa9d9, CC_DIGIT},  // Javanese Digits
+    {0xa9f0, 0xa9f9, CC_DIGIT},  // Myanmar Tai Laing Digits
+    {0xaa50, 0xaa59, CC_DIGIT},  // Cham Digits
+    {0xabf0, 0xabf9, CC_DIGIT},  // Meetei Mayek Digits
+    {0xff10, 0xff19, CC_DIGIT},  // Fullwidth Digits
+    {0x104a0, 0x104a9, CC_DIGIT}, // Osmanya Digits
+    {0x11066, 0x1106f, CC_DIGIT}, // Brahmi Digits
+    {0x110f0, 0x110f9, CC_DIGIT}, // Sora Sompeng Digits
+    {0x11136, 0x1113f, CC_DIGIT}, // Chakma Digits
+    {0x111d0, 0x111d9, CC_DIGIT}, // Sharada Digits
+    {0x112f0, 0x112f9, CC_DIGIT}, // Khudawadi Digits
+    {0x11450, 0x11459, CC_DIGIT}, // Newa Digits
+    {0x114d0, 0x114d9, CC_DIGIT}, // Tirhuta Digits
+    {0x11650, 0x11659, CC_DIGIT}, // Modi Digits
+    {0x116c0, 0x116c9, CC_DIGIT}, // Takri Digits
+    {0x11730, 0x11739, CC_DIGIT}, // Ahom Digits
+    {0x118e0, 0x118e9, CC_DIGIT}, // Warang Citi Digits
+    {0x11c50, 0x11c59, CC_DIGIT}, // Bhaiksuki Digits
+    {0x11d50, 0x11d59, CC_DIGIT}, // Masaram Digits
+    {0x16a60, 0x16a69, CC_DIGIT}, // Mro Digits
+    {0x16b50, 0x16b59, CC_DIGIT}, // Pahawh Digits
+    {0x1d7ce, 0x1d7ff, CC_DIGIT}, // Mathematical Digits
+    {0x1e950, 0x1e959, CC_DIGIT}  // Adlam Digits
+  };
+
+  /**************
+   * page_count *
+   **************/
+
+  /** The number of second level pages needed, including the empty page
+   * shared by all the characters we don't classify.
+   */
+  constexpr std::size_t page_count() {
+    bool used[CC_PAGES] = {};
+    std::size_t result = 1;
+
+    for (const auto &range: char_ranges) {
+      for (char32_t ch = range.first; ch <= range.last; ++ch) {
+        if (not used[ch >> 8]) {
+          used[ch >> 8] = true;
+          ++result;
+        }
+      }
+    }
+    return result;
+  }
 
-    // Thai Digits U+0E50 - U+0E59
-    if (value >= "\u0e50" and value <= "\u0e59") return true;
-
-    // Lao Digits U+0ED0 - U+0ED9
-    if (value >= "\u0ed0" and value <= "\u0ed9") return true;
-
-    // Tibetan Digits U+0F20 - U+0F29
-    if (value >= "\u0f20" and value <= "\u0f29") return true;
-
-    break;
-
-  case '\xe1':
-    // Myanmar Digits U+1040 - U+1049
-    if (std::strcmp(value, "\xe1\x81\x80") >= 0 and
-        std::strcmp(value, "\xe1\x81\x89") <= 0)
-      return 3;
-
-    // Myanmar Shan Digits U+1090 - U+1099
-    if (std::strcmp(value, "\xe1\x82\x90") >= 0 and
-        std::strcmp(value, "\xe1\x82\x99") <= 0)
-      return 3;
-
-    // Khmer Digits U+17E0 - U+17E9
-    if (std::strcmp(value, "\xe1\x9f\xa0") >= 0 and
-        std::strcmp(value, "\xe1\x9f\xa9") <= 0)
-      return 3;
-
-    // Mongolian Digits U+1810 - U+1819
-    if (std::strcmp(value, "\xe1\xa0\x90") >= 0 and
-        std::strcmp(value, "\xe1\xa0\x99") <= 0)
-      return 3;
-
-    // Limbu Digits U+1946 - U+194F
-    if (std::strcmp(value, "\xe1\xa5\x86") >= 0 and
-        std::strcmp(value, "\xe1\xa5\x8f") <= 0)
-      return 3;
-
-    // New Tai Lue Digits U+19D0 - U+19D9
-    if (std::strcmp(value, "\xe1\xa7\x90") >= 0 and
-        std::strcmp(value, "\xe1\xa7\x99") <= 0)
-      return 3;
-
-    // Tai Tham Hora Digits U+1A80 - U+1A89
-    if (std::strcmp(value, "\xe1\xaa\x80") >= 0 and
-        std::strcmp(value, "\xe1\xaa\x89") <= 0)
-      return 3;
-
-    // Tai Tham Tham Digits U+1A90 - U+1A99
-    if (std::strcmp(value, "\xe1\xaa\x90") >= 0 and
-        std::strcmp(value, "\xe1\xaa\x99") <= 0)
-      return 3;
-
-    // Balinese Digits U+1B50 - U+1B59
-    if (std::strcmp(value, "\xe1\xad\x90") >= 0 and
-        std::strcmp(value, "\xe1\xad\x99") <= 0)
-      return 3;
-
-    // Sundanese Digits U+1BB0 - U+1BB9
-    if (std::strcmp(value, "\xe1\xae\xb0") >= 0 and
-        std::strcmp(value, "\xe1\xae\xb9") <= 0)
-      return 3;
-
-    // Lepcha Digits U+1C40 - U+1C49
-    if (std::strcmp(value, "\xe1\xb1\x80") >= 0 and
-        std::strcmp(value, "\xe1\xb1\x89") <= 0)
-      return 3;
-
-    // Ol Chiki Digits U+1C50 - U+1C59
-    if (std::strcmp(value, "\xe1\xb1\x90") >= 0 and
-        std::strcmp(value, "\xe1\xb1\x99") <= 0)
-      return 3;
-
-    break;
-
-  case '\xea':
-    // Vai Digits U+A620 - U+A629
-    if (std::strcmp(value, "\xea\x98\xa0") >= 0 and
-        std::strcmp(value, "\xea\x98\xa9") <= 0)
-      return 3;
-
-    // Saurashtra Digits U+A8D0 - U+A8D9
-    if (std::strcmp(value, "\xea\xa3\x90") >= 0 and
-        std::strcmp(value, "\xea\xa3\x99") <= 0)
-      return 3;
-
-    // Kayah Li Digits U+A900 - U+A909
-    if (std::strcmp(value, "\xea\xa4\x80") >= 0 and
-        std::strcmp(value, "\xea\xa4\x89") <= 0)
-      return 3;
-
-    // Javanese Digits U+A9D0 - U+A9D9
-    if (std::strcmp(value, "\xea\xa7\x90") >= 0 and
-        std::strcmp(value, "\xea\xa7\x99") <= 0)
-      return 3;
-
-    // Myanmar Tai Laing Digits U+A9F0 - U+A9F9
-    if (std::strcmp(value, "\xea\xa7\xb0") >= 0 and
-        std::strcmp(value, "\xea\xa7\xb9") <= 0)
-      return 3;
-
-    // Cham Digits U+AA50 - U+AA59
-    if (std::strcmp(value, "\xea\xa9\x90") >= 0 and
-        std::strcmp(value, "\xea\xa9\x99") <= 0)
-      return 3;
-
-    // Meetei Mayek Digits U+ABF0 - U+ABF9
-    if (std::strcmp(value, "\xea\xaf\xb0") >= 0 and
-        std::strcmp(value, "\xea\xaf\xb9") <= 0)
-      return 3;
-
-    break;
-
-  case '\xf0':
-    // Osmanya Digits U+104A0 - U+104A9
-    if (std::strcmp(value, "\xf0\x90\x92\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x90\x92\xa9") <= 0)
-      return 4;
-
-    // Brahmi Digits U+11066 - U+1106F
-    if (std::strcmp(value, "\xf0\x91\x81\xa6") >= 0 and
-        std::strcmp(value, "\xf0\x91\x81\xaf") <= 0)
-      return 4;
-
-    // Sora Sompeng Digits U+110F0 - U+110F9
-    if (std::strcmp(value, "\xf0\x91\x83\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x83\xb9") <= 0)
-      return 4;
-
-    // Chakma Digits U+11136 - U+1113F
-    if (std::strcmp(value, "\xf0\x91\x84\xb6") >= 0 and
-        std::strcmp(value, "\xf0\x91\x84\xbf") <= 0)
-      return 4;
-
-    // Sharada Digits U+111D0 - U+111D9
-    if (std::strcmp(value, "\xf0\x91\x87\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x87\x99") <= 0)
-      return 4;
-
-    // Khudawadi Digits U+112F0 - U+112F9
-    if (std::strcmp(value, "\xf0\x91\x8b\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x8b\xb9") <= 0)
-      return 4;
-
-    // Newa Digits U+11450 - U+11459
-    if (std::strcmp(value, "\xf0\x91\x91\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x91\x99") <= 0)
-      return 4;
-
-    // Tirhuta Digits U+114D0 - U+114D9
-    if (std::strcmp(value, "\xf0\x91\x93\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x93\x99") <= 0)
-      return 4;
-
-    // Modi Digits U+11650 - U+11659
-    if (std::strcmp(value, "\xf0\x91\x99\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x99\x99") <= 0)
-      return 4;
-
-    // Takri Digits U+116C0 - U+116C9
-    if (std::strcmp(value, "\xf0\x91\x9b\x80") >= 0 and
-        std::strcmp(value, "\xf0\x91\x9b\x89") <= 0)
-      return 4;
-
-    // Ahom Digits U+11730 - U+11739
-    if (std::strcmp(value, "\xf0\x91\x9c\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x9c\xb9") <= 0)
-      return 4;
-
-    // Warang Citi Digits U+118E0 - U+118E9
-    if (std::strcmp(value, "\xf0\x91\xa3\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x91\xa3\xa9") <= 0)
-      return 4;
-
-    // Bhaiksuki Digits U+11C50 - U+11C59
-    if (std::strcmp(value, "\xf0\x91\xb1\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\xb1\x99") <= 0)
-      return 4;
-
-    // Masaram Digits U+11D50 - U+11D59
-    if (std::strcmp(value, "\xf0\x91\xb5\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\xb5\x99") <= 0)
-      return 4;
-
-    // Mro Digits U+16A60 - U+16A69
-    if (std::strcmp(value, "\xf0\x96\xa9\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x96\xa9\xa9") <= 0)
-      return 4;
-
-    // Pahawh Digits U+16B50 - U+16B59
-    if (std::strcmp(value, "\xf0\x96\xad\x90") >= 0 and
-        std::strcmp(value, "\xf0\x96\xad\x99") <= 0)
-      return 4;
-
-    // Mathematical Bold Digits U+1D7CE - U+1D7D7
-    // Mathematical Double-Struck Digits U+1D7D8 - U+1D7E1
-    // Mathematical Sans-Serif Digits U+1D7E2 - U+1D7EB
-    // Mathematical Sans-Serif Bold Digits U+1D7EC - U+1D7F5
-    // Mathematical Monospace Digits U+1D7F6 - U+1D7FF
-    if (std::strcmp(value, "\xf0\x9d\x9f\x8e") >= 0 and
-        std::strcmp(value, "\xf0\x9d\x9f\xbf") <= 0)
-      return 4;
-
-    // Adlam Digits U+1E950 - U+1E959
-    if (std::strcmp(value, "\xf0\x9e\xa5\x90") >= 0 and
-        std::strcmp(value, "\xf0\x9e\xa5\x99") <= 0)
-      return 4;
-
-    break;
-
-  default:
-    // Digits U+0030 - U+0039
-    if (*value >= '\x30' and *value <= '\x39')
-      return 1;
-
-    // Arabic-Indic Digits U+0660 - U+0669
-    if (std::strcmp(value, "\xd9\xa0") >= 0 and
-        std::strcmp(value, "\xd9\xa9") <= 0)
-      return 2;
-
-    // Extended Arabic-Indic Digits U+06F0-U+06F9
-    if (std::strcmp(value, "\xdb\xb0") >= 0 and
-        std::strcmp(value, "\xdb\xb9") <= 0)
-      return 2;
-
-    // NKo Digits U+07C0 - U+07C9
-    if (std::strcmp(value, "\xdf\x80") >= 0 and
-        std::strcmp(value, "\xdf\x89") <= 0)
-      return 2;
-
-    // Fullwidth Digits U+FF10 - U+FF19
-    if (std::strcmp(value, "\xef\xbc\x90") >= 0 and
-        std::strcmp(value, "\xef\xbc\x99") <= 0)
-      return 3;
-
-    break;
+  constexpr std::size_t page_total = page_count();
+
+  struct char_tables_s {
+    unsigned char index[CC_PAGES];
+    unsigned char pages[page_total][256];
+  };
+
+  /***************
+   * make_tables *
+   ***************/
+
+  constexpr char_tables_s make_tables() {
+    char_tables_s result = {};
+    std::size_t next = 1;
+
+    for (const auto &range: char_ranges) {
+      for (char32_t ch = range.first; ch <= range.last; ++ch) {
+        auto &page = result.index[ch >> 8];
+        if (page == 0) page = static_cast<unsigned char>(next++);
+
+        unsigned char cclass = range.cclass;
+        if (cclass == CC_DIGIT) {
+          // Keep the value of the digit in the upper bits.
+          cclass |= static_cast<unsigned char>(((ch - range.first) % 10) << 4);
+        }
+        result.pages[page][ch & 0xff] = cclass;
+      }
+    }
+    return result;
   }
 
-  return 0;
+  constexpr char_tables_s char_tables = make_tables();
 }
 
-static unsigned int to_numeric(const std::string &value) {
-  switch (value[0]) {
-  case '\xe0':
-    // Devavagari Digits U+0966 - U+096F
-    if (value >= "\u0966" and value <= "\u096f") return value[2] - '\xa6';
-
-    // Bengali Digits U+09E6 - U+09EF
-    if (value >= "\u09e6" and value <= "\u09ef") return value[2] - '\xa6';
-
-    // Gurmukhi Digits U+0A66 - U+0A6F
-    if (value >= "\u0a66" and value <= "\u0a6f") return value[2] - '\xa6';
-
-    // Gujarati Digits U+0AE6 - U+0AEF
-    if (value >= "\u0ae6" and value <= "\u0aef") return value[2] - '\xa6';
-
-    // Oriya Digits U+0B66 - U+0B6F
-    if (value >= "\u0b66" and value <= "\u0b6f") return value[2] - '\xa6';
+const unsigned char *const cc_index = char_tables.index;
+const unsigned char (*const cc_pages)[256] = char_tables.pages;
 
-    // Tamil Digits U+0BE6 - U+0BEF
-    if (value >= "\u0be6" and value <= "\u0bef") return value[2] - '\xa6';
+/***************
+ * decode_utf8 *
+ ***************/
 
-    // Telugu Digits U+0C66 - U+0C6F
-    if (value >= "\u0c66" and value <= "\u0c6f") return value[2] - '\xa6';
-
-    // Kannada Digits U+0CE6 - U+0CEF
-    if (value >= "\u0ce6" and value <= "\u0cef") return value[2] - '\xa6';
-
-    // Malayalam Digits U+0D66 - U+0D6F
-    if (value >= "\u0d66" and value <= "\u0d6f") return value[2] - '\xa6';
-
-    // Sinhala Digits U+0DE6 - U+0DEF
-    if (value >= "\u0de6" and value <= "\u0def") return value[2] - '\xa6';
-
-    // Thai Digits U+0E50 - U+0E59
-    if (value >= "\u0e50" and value <= "\u0e59") return value[2] - '\x90';
-
-    // Lao Digits U+0ED0 - U+0ED9
-    if (value >= "\u0ed0" and value <= "\u0ed9") return value[2] - '\x90';
+std::size_t decode_utf8(std::string_view value, char32_t &ch) {
+  if (value.empty()) {
+    ch = 0;
+    return 0;
+  }
 
-    // Tibetan Digits U+0F20 - U+0F29
-    if (value >= "\u0f20" and value <= "\u0f29") return value[2] - '\xa0';
+  const auto lead = static_cast<unsigned char>(value[0]);
+  std::size_t length;
+
+  if (lead < 0x80) {
+    ch = lead;
+    return 1;
+  } else if ((lead & 0xe0) == 0xc0) {
+    ch = lead & 0x1f;
+    length = 2;
+  } else if ((lead & 0xf0) == 0xe0) {
+    ch = lead & 0x0f;
+    length = 3;
+  } else if ((lead & 0xf8) == 0xf0) {
+    ch = lead & 0x07;
+    length = 4;
+  } else {
+    // Not a valid leading byte.
+    ch = 0xfffd;
+    return 1;
+  }
 
-    break;
+  if (value.length() < length) {
+    ch = 0xfffd;
+    return value.length();
+  }
 
-  case '\xe1':
-    // Myanmar Digits U+1040 - U+1049
-    if (value >= "\u1040" and value <= "\u1049") return value[2] - '\x80';
+  for (std::size_t i = 1; i < length; ++i) {
+    const auto byte = static_cast<unsigned char>(value[i]);
+    if ((byte & 0xc0) != 0x80) {
+      ch = 0xfffd;
+      return i;
+    }
+    ch = (ch << 6) | (byte & 0x3f);
+  }
+  return length;
+}
 
-    // Myanmar Shan Digits U+1090 - U+1099
-    if (value >= "\u1090" and value <= "\u1099") return value[2] - '\x90';
+/*****************
+ * classify_utf8 *
+ *****************/
 
-    // Khmer Digits U+17E0 - U+17E9
-    if (std::strcmp(value, "\xe1\x9f\xa0") >= 0 and
-        std::strcmp(value, "\xe1\x9f\xa9") <= 0)
-      return value[2] - '\xa0';
+unsigned char classify_utf8(std::string_view value) {
+  if (value.empty()) return CC_OTHER;
 
-    // Mongolian Digits U+1810 - U+1819
-    if (value >= "\u1810" and value <= "\u1819") return value[2] - '\x90';
+  // Most of what we see is ASCII, so skip the decoding.
+  const auto lead = static_cast<unsigned char>(value[0]);
+  if (lead < 0x80) {
+    if (value.length() != 1) return CC_OTHER;
+    return classify(lead);
+  }
 
-    // Limbu Digits U+1946 - U+194F
-    if (std::strcmp(value, "\xe1\xa5\x86") >= 0 and
-        std::strcmp(value, "\xe1\xa5\x8f") <= 0)
-      return value[2] - '\x86';
+  char32_t ch;
+  if (decode_utf8(value, ch) != value.length()) return CC_OTHER;
+  return classify(ch);
+}
 
-    // New Tai Lue Digits U+19D0 - U+19D9
-    if (value >= "\u19d0" and value <= "\u19d9") return value[2] - '\x90';
+/************
+ * is_space *
+ ************/
 
-    // Tai Tham Hora Digits U+1A80 - U+1A89
-    if (std::strcmp(value, "\xe1\xaa\x80") >= 0 and
-        std::strcmp(value, "\xe1\xaa\x89") <= 0)
-      return value[2] - '\x80';
+bool is_space(std::string_view value) {
+  return (classify_utf8(value) & CC_SPACE) != 0;
+}
 
-    // Tai Tham Tham Digits U+1A90 - U+1A99
-    if (value >= "\u1a90" and value <= "\u1a99") return value[2] - '\x90';
+/**********
+ * is_eol *
+ **********/
 
-    // Balinese Digits U+1B50 - U+1B59
-    if (value >= "\u1b50" and value <= "\u1b59") return value[2] - '\x90';
+bool is_eol(std::string_view value) {
+  // Check for all of the unicode end of line characters.
+  if (value == "\u000d\u000a") return true; // CR LF \r\n
+  return (classify_utf8(value) & CC_EOL) != 0;
+}
 
-    // Sundanese Digits U+1BB0 - U+1BB9
-    if (std::strcmp(value, "\xe1\xae\xb0") >= 0 and
-        std::strcmp(value, "\xe1\xae\xb9") <= 0)
-      return value[2] - '\xb0';
+std::string env(const std::string &name) {
+  const char *value = getenv(name.c_str());
+  if (value == nullptr) return "";
+  return value;
+}
 
-    // Lepcha Digits U+1C40 - U+1C49
-    if (std::strcmp(value, "\xe1\xb1\x80") >= 0 and
-        std::strcmp(value, "\xe1\xb1\x89") <= 0)
-      return value[2] - '\x80';
+/*************
+ * load_file *
+ *************/
 
-    // Ol Chiki Digits U+1C50 - U+1C59
-    if (value >= "\u1c50" and value <= "\u1c59") return value[2] - '\x90';
-
-    break;
+bool load_file(const std::string &filename, std::string &value) {
+#if defined (__linux__) || defined(__FreeBSD__)
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
 
-  case '\xea':
-    // Vai Digits U+A620 - U+A629
-    if (std::strcmp(value, "\xea\x98\xa0") >= 0 and
-        std::strcmp(value, "\xea\x98\xa9") <= 0)
-      return value[2] - '\xa0';
-
-    // Saurashtra Digits U+A8D0 - U+A8D9
-    if (std::strcmp(value, "\xea\xa3\x90") >= 0 and
-        std::strcmp(value, "\xea\xa3\x99") <= 0)
-      return value[2] - '\x90';
-
-    // Kayah Li Digits U+A900 - U+A909
-    if (std::strcmp(value, "\xea\xa4\x80") >= 0 and
-        std::strcmp(value, "\xea\xa4\x89") <= 0)
-      return value[2] - '\x80';
-
-    // Javanese Digits U+A9D0 - U+A9D9
-    if (std::strcmp(value, "\xea\xa7\x90") >= 0 and
-        std::strcmp(value, "\xea\xa7\x99") <= 0)
-      return value[2] - '\x90';
-
-    // Myanmar Tai Laing Digits U+A9F0 - U+A9F9
-    if (std::strcmp(value, "\xea\xa7\xb0") >= 0 and
-        std::strcmp(value, "\xea\xa7\xb9") <= 0)
-      return value[2] - '\xb0';
-
-    // Cham Digits U+AA50 - U+AA59
-    if (std::strcmp(value, "\xea\xa9\x90") >= 0 and
-        std::strcmp(value, "\xea\xa9\x99") <= 0)
-      return value[2] - '\x90';
-
-    // Meetei Mayek Digits U+ABF0 - U+ABF9
-    if (std::strcmp(value, "\xea\xaf\xb0") >= 0 and
-        std::strcmp(value, "\xea\xaf\xb9") <= 0)
-      return value[2] - '\xb0';
-
-    break;
-
-  case '\xf0':
-    // Osmanya Digits U+104A0 - U+104A9
-    if (std::strcmp(value, "\xf0\x90\x92\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x90\x92\xa9") <= 0)
-      return value[3] - '\xa0';
-
-    // Brahmi Digits U+11066 - U+1106F
-    if (std::strcmp(value, "\xf0\x91\x81\xa6") >= 0 and
-        std::strcmp(value, "\xf0\x91\x81\xaf") <= 0)
-      return value[3] - '\xa6';
-
-    // Sora Sompeng Digits U+110F0 - U+110F9
-    if (std::strcmp(value, "\xf0\x91\x83\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x83\xb9") <= 0)
-      return value[3] - '\xb0';
-
-    // Chakma Digits U+11136 - U+1113F
-    if (std::strcmp(value, "\xf0\x91\x84\xb6") >= 0 and
-        std::strcmp(value, "\xf0\x91\x84\xbf") <= 0)
-      return value[3] - '\xb6';
-
-    // Sharada Digits U+111D0 - U+111D9
-    if (std::strcmp(value, "\xf0\x91\x87\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x87\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Khudawadi Digits U+112F0 - U+112F9
-    if (std::strcmp(value, "\xf0\x91\x8b\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x8b\xb9") <= 0)
-      return value[3] - '\xb0';
-
-    // Newa Digits U+11450 - U+11459
-    if (std::strcmp(value, "\xf0\x91\x91\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x91\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Tirhuta Digits U+114D0 - U+114D9
-    if (std::strcmp(value, "\xf0\x91\x93\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x93\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Modi Digits U+11650 - U+11659
-    if (std::strcmp(value, "\xf0\x91\x99\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\x99\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Takri Digits U+116C0 - U+116C9
-    if (std::strcmp(value, "\xf0\x91\x9b\x80") >= 0 and
-        std::strcmp(value, "\xf0\x91\x9b\x89") <= 0)
-      return value[3] - '\x80';
-
-    // Ahom Digits U+11730 - U+11739
-    if (std::strcmp(value, "\xf0\x91\x9c\xb0") >= 0 and
-        std::strcmp(value, "\xf0\x91\x9c\xb9") <= 0)
-      return value[3] - '\xb0';
-
-    // Warang Citi Digits U+118E0 - U+118E9
-    if (std::strcmp(value, "\xf0\x91\xa3\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x91\xa3\xa9") <= 0)
-      return value[3] - '\xa0';
-
-    // Bhaiksuki Digits U+11C50 - U+11C59
-    if (std::strcmp(value, "\xf0\x91\xb1\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\xb1\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Masaram Digits U+11D50 - U+11D59
-    if (std::strcmp(value, "\xf0\x91\xb5\x90") >= 0 and
-        std::strcmp(value, "\xf0\x91\xb5\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Mro Digits U+16A60 - U+16A69
-    if (std::strcmp(value, "\xf0\x96\xa9\xa0") >= 0 and
-        std::strcmp(value, "\xf0\x96\xa9\xa9") <= 0)
-      return value[3] - '\xa0';
-
-    // Pahawh Digits U+16B50 - U+16B59
-    if (std::strcmp(value, "\xf0\x96\xad\x90") >= 0 and
-        std::strcmp(value, "\xf0\x96\xad\x99") <= 0)
-      return value[3] - '\x90';
-
-    // Mathematical Bold Digits U+1D7CE - U+1D7D7
-    // Mathematical Double-Struck Digits U+1D7D8 - U+1D7E1
-    // Mathematical Sans-Serif Digits U+1D7E2 - U+1D7EB
-    // Mathematical Sans-Serif Bold Digits U+1D7EC - U+1D7F5
-    // Mathematical Monospace Digits U+1D7F6 - U+1D7FF
-    if (std::strcmp(value, "\xf0\x9d\x9f\x8e") >= 0 and
-        std::strcmp(value, "\xf0\x9d\x9f\xbf") <= 0)
-      return (value[3] - '\x8e') % 10;
-
-    // Adlam Digits U+1E950 - U+1E959
-    if (std::strcmp(value, "\xf0\x9e\xa5\x90") >= 0 and
-        std::strcmp(value, "\xf0\x9e\xa5\x99") <= 0)
-      return value[3] - '\x90';
-
-    break;
-
-  default:
-    // Digits U+0030 - U+0039
-    if (value[0] >= '\x30' and value[0] <= '\x39')
-      return value[0] - '\x30';
-
-    // Arabic-Indic Digits U+0660 - U+0669
-    if (std::strcmp(value, "\xd9\xa0") >= 0 and
-        std::strcmp(value, "\xd9\xa9") <= 0)
-      return value[1] - '\xa0';
-
-    // Extended Arabic-Indic Digits U+06F0-U+06F9
-    if (std::strcmp(value, "\xdb\xb0") >= 0 and
-        std::strcmp(value, "\xdb\xb9") <= 0)
-      return value[1] - '\xb0';
-
-    // NKo Digits U+07C0 - U+07C9
-    if (std::strcmp(value, "\xdf\x80") >= 0 and
-        std::strcmp(value, "\xdf\x89") <= 0)
-      return value[1] - '\x80';
-
-    // Fullwidth Digits U+FF10 - U+FF19
-    if (std::strcmp(value, "\xef\xbc\x90") >= 0 and
-        std::strcmp(value, "\xef\xbc\x99") <= 0)
-      return value[2] - '\x90';
-
-    break;
+  // Pipes, terminals and the like have to be streamed.
+  struct stat info;
+  if (fstat(fd, &info) != 0 or not S_ISREG(info.st_mode)) {
+    close(fd);
+    return false;
   }
 
-  return 0;
-}*/
+  // Read straight into the string, sized up front.
+  value.resize(static_cast<size_t>(info.st_size));
+  size_t length = 0;
+  while (length < value.size()) {
+    ssize_t count = read(fd, &value[length], value.size() - length);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      close(fd);
+      value.clear();
+      return false;
+    }
+    if (count == 0) break;
+    length += static_cast<size_t>(count);
+  }
+  close(fd);
+
+  // The file may have been truncated while we were reading it.
+  value.resize(length);
+  return true;
+#else
+  (void)filename;
+  (void)value;
+  return false;
+#endif
+}
 
 /******************************************************************************
  * class cutlet::arg_tokens
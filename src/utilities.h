@@ -28,7 +28,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 #if defined (__linux__) || defined(__FreeBSD__)
 #include <dlfcn.h>
@@ -45,10 +47,70 @@ typedef HMODULE nativelib_t;
 
 bool fexists(const std::string &filename);
 
-bool is_space(const std::string &value);
+/** Whether filename was modified after other. False if filename doesn't
+ * exist, true if only other doesn't.
+ */
+bool fnewer(const std::string &filename, const std::string &other);
+
+/* Unicode character classification. The classes of a code point are
+ * looked up in a two level table, the first level is indexed by the upper
+ * bits of the code point and gives the page of 256 classes for it. Digits
+ * also have their value stored in the upper 4 bits of the class.
+ */
+
+enum : unsigned char {
+  CC_OTHER = 0x00,
+  CC_SPACE = 0x01,
+  CC_EOL   = 0x02,
+  CC_DIGIT = 0x04,
+  CC_MASK  = 0x0f
+};
+
+// All the code points we classify are below U+20000.
+const char32_t CC_PAGES = 0x200;
+
+extern const unsigned char *const cc_index;
+extern const unsigned char (*const cc_pages)[256];
+
+/** Classify a single code point.
+ */
+inline unsigned char classify(char32_t ch) {
+  if (ch >= (CC_PAGES << 8)) return CC_OTHER;
+  return cc_pages[cc_index[ch >> 8]][ch & 0xff];
+}
+
+inline bool is_digit(char32_t ch) {
+  return (classify(ch) & CC_DIGIT) != 0;
+}
 
-bool is_eol(const std::string &value);
+/** The numeric value of a digit in any script.
+ */
+inline unsigned int digit_value(char32_t ch) {
+  return classify(ch) >> 4;
+}
+
+/** Decode the first UTF-8 character of value.
+ * @return The number of bytes used. Invalid sequences decode to U+FFFD.
+ */
+std::size_t decode_utf8(std::string_view value, char32_t &ch);
+
+/** Classify a single UTF-8 character. Anything that isn't exactly one
+ * character is CC_OTHER.
+ */
+unsigned char classify_utf8(std::string_view value);
+
+bool is_space(std::string_view value);
+
+bool is_eol(std::string_view value);
 
 std::string env(const std::string &name);
 
+/** Read the whole of a regular file into value with a single buffer sized
+ * from the file, rather than a line at a time.
+ * @return False if the file couldn't be opened or read, or isn't a regular
+ *         file, ie. a pipe or terminal. The caller should fall back to
+ *         reading it as a stream.
+ */
+bool load_file(const std::string &filename, std::string &value);
+
 #endif /* _CUTLET_UTILS_H */
@@ -31,6 +31,15 @@
 #include "testsuite.h"
 #include <cutlet>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace {
 
@@ -55,6 +64,913 @@ namespace {
     }
     test << test::assert(result == "dlroW olleH");
   }
+
+  /******************
+   * test_tokenizer *
+   ******************/
+
+  void test_tokenizer(test::TestSuite &suite) {
+    auto &test = suite.test("Tokenizer");
+
+    cutlet::interpreter interp;
+
+    /* Long enough that the structural characters land on both sides of
+     * the 16 and 32 byte boundaries the scanner works on.
+     */
+    std::string filler(70, 'x');
+
+    interp("global a = \"" + filler + "\\\"ü" + filler + "\"\n");
+    test << test::assert(*interp.var("a") == filler + "\"ü" + filler);
+
+    interp("global b = '" + filler + "\\'\\\\" + filler + "'\n");
+    test << test::assert(*interp.var("b") == filler + "'\\" + filler);
+
+    interp("global c = {" + filler + "{ü {" + filler + "}}\n" + filler +
+           "}\n");
+    test << test::assert(*interp.var("c") ==
+                         filler + "{ü {" + filler + "}}\n" + filler);
+
+    interp("global d = [list " + filler + " {[" + filler + "]\n}]\n");
+    test << test::assert(*interp.var("d") ==
+                         "{" + filler + " [" + filler + "]\n}");
+
+    // Strings can't span lines.
+    try {
+      interp("global e = \"" + filler + "\n\"\n");
+      test << test::fail << "Unmatched \" not detected";
+    } catch (parser::syntax_error &) {
+    }
+  }
+
+  /***********************
+   * test_token_patterns *
+   ***********************/
+
+  class pattern_tokenizer : public parser::tokenizer {
+  public:
+    enum {
+      T_KEYWORD = 1, T_NAME, T_NUMBER, T_SPACE, T_OPERATOR, T_QUOTED
+    };
+
+    pattern_tokenizer(bool regular) {
+      add_token_pattern(T_KEYWORD, "if|else");
+      add_token_pattern(T_NAME, "[a-zA-Z_]\\w*");
+      add_token_pattern(T_NUMBER, "\\d+(?:\\.\\d{1,3})?");
+      add_token_pattern(T_SPACE, "[ \\t]+");
+      add_token_pattern(T_OPERATOR, "==|[=+*/-]");
+
+      // A back reference can't go in the automaton.
+      if (not regular) add_token_pattern(T_QUOTED, "(['\"]).*?\\1");
+    }
+  };
+
+  void test_token_patterns(test::TestSuite &suite) {
+    auto &test = suite.test("Token Patterns");
+
+    for (bool regular: {true, false}) {
+      pattern_tokenizer tokens(regular);
+
+      // Longest match, with ties going to the first pattern added.
+      try {
+        tokens.parse("iffy = 12.5 if x == 3");
+        tokens.permit(pattern_tokenizer::T_NAME, "iffy");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        tokens.permit(pattern_tokenizer::T_OPERATOR, "=");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        tokens.permit(pattern_tokenizer::T_NUMBER, "12.5");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        tokens.permit(pattern_tokenizer::T_KEYWORD, "if");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        tokens.permit(pattern_tokenizer::T_NAME, "x");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        tokens.permit(pattern_tokenizer::T_OPERATOR, "==");
+        tokens.permit(pattern_tokenizer::T_SPACE);
+        test << test::assert(tokens.expect(pattern_tokenizer::T_NUMBER, "3"));
+      } catch (parser::syntax_error &err) {
+        test << test::fail << err.what();
+      }
+
+      try {
+        tokens.parse("x = #");
+        test << test::fail << "Invalid token not detected";
+      } catch (parser::syntax_error &) {
+      }
+    }
+  }
+
+  /***********************
+   * test_parallel_parse *
+   ***********************/
+
+  /** Cutlet code with blocks, subcommands, comments and line continuations
+   * that all have to be kept whole when the script is split up.
+   */
+  std::string parse_group(int count) {
+    auto n = std::to_string(count);
+    return "# Comment " + n + " with an unmatched { and \"\n" +
+      "global a" + n + " = \"string \\\" {\\[ " + n + "\"\n" +
+      "global b" + n + " = {\n  line {nested}\n  " + n + "\n}\n" +
+      "global c" + n + " = \\\n  continued" + n + "\n" +
+      "global d" + n + " = [list " + n + " {\n x }]\n\n";
+  }
+
+  class chunk_interpreter : public cutlet::interpreter {
+  public:
+    using cutlet::interpreter::_parse_chunks;
+  };
+
+  void test_parallel_parse(test::TestSuite &suite) {
+    auto &test = suite.test("Parallel Parse");
+
+    const std::string filename = "parallel-parse.cutlet";
+    const int groups = 5000;
+
+    // Big enough to be split into chunks.
+    std::string code;
+    for (int count = 0; count < groups; ++count) code += parse_group(count);
+    {
+      std::ofstream script(filename);
+      script << code;
+    }
+
+    chunk_interpreter interp;
+    try {
+      test << test::assert(interp._parse_chunks(code, filename, 4) !=
+                           nullptr);
+
+      // Small scripts, or a single thread, are parsed serially.
+      test << test::assert(interp._parse_chunks(code, filename, 1) ==
+                           nullptr);
+      test << test::assert(interp._parse_chunks(parse_group(0), filename,
+                                                4) == nullptr);
+
+      // Even on a single CPU machine.
+      interp.parse_threads(4);
+      interp.compile_file(filename);
+
+      // Compare with the same code parsed on its own.
+      for (int count: {0, 1234, 2500, groups - 1}) {
+        cutlet::interpreter serial;
+        serial(parse_group(count));
+
+        auto n = std::to_string(count);
+        for (auto name: {"a", "b", "c", "d"}) {
+          test << test::assert(*interp.var(name + n) ==
+                               static_cast<std::string>(
+                                 *serial.var(name + n)));
+        }
+      }
+    } catch (std::exception &err) {
+      test << test::fail << err.what();
+    }
+
+    std::remove(filename.c_str());
+  }
+
+  /*******************
+   * test_call_cache *
+   *******************/
+
+  void test_call_cache(test::TestSuite &suite) {
+    auto &test = suite.test("Call Site Cache");
+
+    cutlet::interpreter interp;
+    auto which = [](const std::string &name) {
+      return [name](cutlet::interpreter &interp, const cutlet::list &) {
+        interp.global("which", cutlet::var<cutlet::string>(name));
+        return cutlet::variable::pointer();
+      };
+    };
+
+    interp.add("which", which("first"));
+    auto code = interp("which\n");
+    test << test::assert(*interp.var("which") == "first");
+
+    // Running the same code again goes through the cache.
+    auto hits = cutlet::sandbox::cache_hits();
+    (*code)(interp);
+    test << test::assert(cutlet::sandbox::cache_hits() == hits + 1);
+
+    // Replacing the component has to be seen by the cached call site.
+    interp.add("which", which("second"));
+    (*code)(interp);
+    test << test::assert(*interp.var("which") == "second");
+
+    interp.remove("which");
+    interp.add("¿component?", which("unknown"));
+    (*code)(interp);
+    test << test::assert(*interp.var("which") == "unknown");
+  }
+
+  /*********************
+   * test_shared_cache *
+   *********************/
+
+  void test_shared_cache(test::TestSuite &suite) {
+    auto &test = suite.test("Shared Call Site Cache");
+
+    /* Compiled code, and the caches in it, may be run by interpreters on
+     * several threads at once. Each thread's which gives its own name, and
+     * replacing it keeps the caches being refilled while others read them.
+     */
+    cutlet::interpreter compiler;
+    auto code = compiler.compile("def f {n} {\n"
+                                 "  local x = $n\n"
+                                 "  return $x\n"
+                                 "}\n"
+                                 "global r [f [which]]\n"
+                                 "global s $r\n");
+
+    const unsigned int threads = 4;
+    std::vector<unsigned int> failed(threads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned int id = 0; id < threads; ++id) {
+      workers.emplace_back([&code, &failed, id]() {
+        cutlet::interpreter interp;
+        const std::string name = "thread " + std::to_string(id);
+        for (unsigned int count = 0; count < 2000; ++count) {
+          interp.add("which", [name](cutlet::interpreter &,
+                                     const cutlet::list &) {
+            return cutlet::var<cutlet::string>(name);
+          });
+          try {
+            (*code)(interp);
+            if (*interp.var("r") != name or *interp.var("s") != name)
+              ++failed[id];
+          } catch (std::exception &) {
+            ++failed[id];
+          }
+        }
+      });
+    }
+    for (auto &worker: workers) worker.join();
+
+    for (unsigned int id = 0; id < threads; ++id)
+      test << test::assert(failed[id] == 0);
+  }
+
+  /****************
+   * test_compile *
+   ****************/
+
+  void test_compile(test::TestSuite &suite) {
+    auto &test = suite.test("Compile Only");
+
+    cutlet::interpreter interp, other;
+    auto count = [](cutlet::interpreter &interp, const cutlet::list &) {
+      auto n = interp.var("count");
+      interp.global("count", cutlet::var<cutlet::string>(
+                               static_cast<std::string>(*n) + "+"));
+      return cutlet::variable::pointer();
+    };
+    for (auto *i: {&interp, &other}) {
+      i->global("count", cutlet::var<cutlet::string>(""));
+      i->add("count", count);
+    }
+
+    auto program = interp.compile("count\ncount\n");
+    test << test::assert(*interp.var("count") == "");
+
+    (*program)(interp);
+    (*program)(interp);
+    test << test::assert(*interp.var("count") == "++++");
+
+    (*program)(other);
+    test << test::assert(*other.var("count") == "++");
+
+    // A failed compile mustn't leave the interpreter compiling.
+    try {
+      interp.compile("count \"\n");
+      test << test::fail << "Syntax error not detected";
+    } catch (parser::syntax_error &) {
+    }
+    interp("count\n");
+    test << test::assert(*interp.var("count") == "+++++");
+  }
+
+  /*********************
+   * test_compile_file *
+   *********************/
+
+  void test_compile_file(test::TestSuite &suite) {
+    auto &test = suite.test("Compile File");
+
+    const char *name = "compile-file-test.cutlet";
+    auto write = [name](const std::string &code) {
+      std::ofstream out(name, std::ios::trunc);
+      out << code;
+    };
+    cutlet::interpreter interp;
+
+    // The last line doesn't need to be terminated.
+    write("global a = 1\nglobal b = $a");
+    interp.compile_file(name);
+    test << test::assert(*interp.var("b") == "1");
+
+    // An empty file is an empty program.
+    write("");
+    test << test::assert(interp.compile_file(name) != nullptr);
+
+    // Syntax errors are reported with their position in the file.
+    write("global a = 1\nglobal b \"2\n");
+    try {
+      interp.compile_file(name);
+      test << test::fail << "Syntax error not detected";
+    } catch (parser::syntax_error &err) {
+      test << test::assert(err.get_token().position() == 22);
+    }
+
+    // Files that can't be read are errors, not empty programs.
+    chmod(name, 0);
+    if (access(name, R_OK) != 0) {
+      try {
+        interp.compile_file(name);
+        test << test::fail << "Unreadable file not detected";
+      } catch (std::runtime_error &) {
+      }
+    }
+    std::remove(name);
+
+    try {
+      interp.compile_file(name);
+      test << test::fail << "Missing file not detected";
+    } catch (std::runtime_error &) {
+    }
+  }
+
+  /**********************
+   * test_compile_cache *
+   **********************/
+
+  void test_compile_cache(test::TestSuite &suite) {
+    auto &test = suite.test("Compile Cache");
+
+    cutlet::interpreter interp;
+    interp.compile_cache(2);
+
+    auto first = interp("global a = 1\n");
+    test << test::assert(interp("global a = 1\n") == first);
+    test << test::assert(interp.compile_cache_hits() == 1);
+
+    // The least recently used program is dropped first.
+    auto second = interp("global b = 2\n");
+    interp("global a = 1\n");
+    interp("global c = 3\n");
+    test << test::assert(interp("global a = 1\n") == first);
+    test << test::assert(interp("global b = 2\n") != second);
+    test << test::assert(interp.compile_cache_misses() == 4);
+
+    interp.compile_cache(0);
+    test << test::assert(interp("global a = 1\n") != first);
+
+    /* Blocks in a script are found by where they are in it, so the same
+     * text in two places is two programs, each found again when run again.
+     */
+    cutlet::interpreter script;
+    std::vector<cutlet::ast::node::pointer> ran;
+    script.add("run", [&ran](cutlet::interpreter &interp,
+                             const cutlet::list &args) {
+      ran.push_back(interp(args[0]));
+      return cutlet::variable::pointer();
+    });
+    test << test::assert(script.compile_cache() == 256);
+
+    std::string code;
+    for (unsigned int count = 0; count < 300; ++count)
+      code += "run {global a = 1}\n";
+    auto program = script.compile(code);
+    (*program)(script);
+    (*program)(script);
+    test << test::assert(ran.size() == 600);
+    test << test::assert(ran[0] != ran[1]);
+    test << test::assert(ran[0] == ran[300] and ran[299] == ran[599]);
+
+    // The cache grew to hold all of the script's blocks, but not lists'.
+    script.list(std::string("a {b} {c}"));
+    test << test::assert(script.compile_cache() == 300);
+    test << test::assert(script.compile_cache_misses() == 300);
+    test << test::assert(script.compile_cache_hits() == 300);
+
+    // Compiling the same script again doesn't grow it any further.
+    for (unsigned int count = 0; count < 10; ++count) script.compile(code);
+    test << test::assert(script.compile_cache() == 300);
+
+    // Nor does it grow past its limit for a script with more blocks.
+    std::string big;
+    for (unsigned int count = 0; count < 20000; ++count)
+      big += "run {}\n";
+    script.compile(big);
+    script.compile(big);
+    test << test::assert(script.compile_cache() == 16384);
+
+    // Once its size is set it stays there.
+    script.compile_cache(10);
+    script.compile(code);
+    test << test::assert(script.compile_cache() == 10);
+  }
+
+  /******************
+   * test_arguments *
+   ******************/
+
+  void test_arguments(test::TestSuite &suite) {
+    auto &test = suite.test("Argument Lists");
+
+    cutlet::interpreter interp;
+    std::vector<const cutlet::list *> seen;
+    interp.add("seen", [&seen](cutlet::interpreter &, const cutlet::list &a) {
+      seen.push_back(&a);
+      if (a.size() == 1 and *a[0] == "fail")
+        throw std::runtime_error("failed");
+      return cutlet::var<cutlet::string>("x");
+    });
+
+    // Nested calls each get their own list.
+    interp("seen [seen 1] 2\n");
+    test << test::assert(seen.size() == 2 and seen[0] != seen[1]);
+
+    // Lists are reused once the call is done, even after an error.
+    try {
+      interp("seen fail\n");
+      test << test::fail << "Error not thrown";
+    } catch (std::exception &) {
+    }
+    interp("seen 1\n");
+    test << test::assert(seen[2] == seen[1] and seen[3] == seen[1]);
+  }
+
+  /*****************
+   * test_optimize *
+   *****************/
+
+  void test_optimize(test::TestSuite &suite) {
+    auto &test = suite.test("Optimize");
+
+    cutlet::interpreter interp;
+    std::vector<cutlet::variable::pointer> seen;
+    interp.add("seen", [&seen](cutlet::interpreter &, const cutlet::list &a) {
+      for (auto &arg: a) seen.push_back(arg);
+      return cutlet::variable::pointer();
+    });
+    interp.global("x", cutlet::var<cutlet::string>("x"));
+
+    // Strings with nothing to substitute are built once.
+    interp.optimize(1);
+    auto program = interp.compile("# A comment\nseen \"a b\" \"a $x\"\n");
+    (*program)(interp);
+    (*program)(interp);
+    test << test::assert(seen.size() == 4);
+    test << test::assert(seen[0] == seen[2] and *seen[0] == "a b");
+    test << test::assert(seen[1] != seen[3] and *seen[3] == "a x");
+
+    seen.clear();
+    interp.optimize(0);
+    program = interp.compile("seen \"a b\"\n");
+    (*program)(interp);
+    (*program)(interp);
+    test << test::assert(seen[0] != seen[1] and *seen[1] == "a b");
+
+    // Comments are kept while there is a debugger to stop at them.
+    unsigned int comments = 0;
+    cutlet::ast::node::debugger(
+      [&comments](cutlet::interpreter &, const cutlet::ast::node &node) {
+        if (node.id() == cutlet::A_COMMENT) ++comments;
+      });
+    cutlet::ast::node::break_all = true;
+    interp.optimize(1);
+    (*interp.compile("# A comment\nseen 1\n"))(interp);
+    cutlet::ast::node::break_all = false;
+    cutlet::ast::node::debugger(nullptr);
+    test << test::assert(comments == 1);
+  }
+
+  /*****************
+   * test_emit_cpp *
+   *****************/
+
+  void test_emit_cpp(test::TestSuite &suite) {
+    auto &test = suite.test("Emit C++");
+
+    cutlet::interpreter interp;
+    std::stringstream out;
+    interp.emit_cpp("include.cutlet", out);
+    test << test::assert(out.str().find("void init_cutlet") !=
+                         std::string::npos);
+    test << test::assert(out.str().find("\"I got included\"") !=
+                         std::string::npos);
+
+    // def runs a native body in place of the script.
+    unsigned int calls = 0;
+    cutlet::sandbox::call_cache_t cache;
+    cutlet::list args;
+    args.push_back(cutlet::var<cutlet::string>("f"));
+    args.push_back(cutlet::var<cutlet::string>("x"));
+    args.push_back(cutlet::var<cutlet::string>("return $x"));
+    interp.def(args, [&calls](cutlet::interpreter &interp) {
+      ++calls;
+      interp.global("y", interp.var("x"));
+    }, cache);
+    interp("f 1\n");
+    test << test::assert(calls == 1 and *interp.var("y") == "1");
+
+    // Unless def isn't the builtin one.
+    interp.add("def", [](cutlet::interpreter &, const cutlet::list &) {
+      return cutlet::var<cutlet::string>("other");
+    });
+    test << test::assert(*interp.def(args, nullptr, cache) == "other");
+  }
+
+  /*****************
+   * test_bytecode *
+   *****************/
+
+  /* Run code with or without bytecode, returning where each break point was
+   * hit and the error raised, if any.
+   */
+  std::string trace(const std::string &code, bool bytecode) {
+    std::stringstream result;
+    cutlet::interpreter interp;
+    interp.bytecode(bytecode);
+    interp.add("fails", [](cutlet::interpreter &, const cutlet::list &) {
+      throw std::runtime_error("failed");
+      return cutlet::variable::pointer();
+    });
+
+    cutlet::ast::node::debugger([&result](cutlet::interpreter &,
+                                          const cutlet::ast::node &node) {
+      result << node.id() << "@" << node.position() << " ";
+    });
+    cutlet::ast::node::break_all = true;
+    try {
+      interp(code);
+    } catch (cutlet::exception &err) {
+      result << "| " << err.what();
+      if (err.node()) result << " @" << err.node()->position();
+    }
+    cutlet::ast::node::break_all = false;
+    cutlet::ast::node::debugger(nullptr);
+
+    return result.str();
+  }
+
+  void test_bytecode(test::TestSuite &suite) {
+    auto &test = suite.test("Bytecode");
+
+    /* The bytecode only covers the top level block, nested blocks are run
+     * by the interpreter. Both have to stop at the same break points and
+     * report errors at the same place as the syntax tree does.
+     */
+    const std::string codes[] = {
+      "# A comment\nglobal a = \"x $a [list 1 2]\"\nlist $a {b c}\n",
+      "def f {x} {\n  local y = $x\n  fails $y\n}\nglobal a = 1\nf $a\n",
+      "global a = [list a b]\n$a append [fails]\n",
+      "def g {} { return [list 1] }\nglobal r = [g]\nfails\n"
+    };
+
+    for (auto &code: codes) {
+      auto walked = trace(code, false);
+      auto run = trace(code, true);
+      test << test::assert(run == walked) << walked << " != " << run << "\n";
+    }
+  }
+
+  /*******************
+   * test_tail_calls *
+   *******************/
+
+  void test_tail_calls(test::TestSuite &suite) {
+    auto &test = suite.test("Tail Calls");
+
+    cutlet::interpreter interp;
+    cutlet::cast<cutlet::list>(interp.var("library.path")).push_back(
+      cutlet::var<cutlet::string>("../libs/.libs"));
+    interp.import("stdlib");
+    interp.max_depth(100);
+    interp.global("limit", cutlet::var<cutlet::string>(std::string(500, '+')));
+
+    // Tail calls, even between functions, don't use up the stack.
+    interp("def ping {n} {\n"
+           "  if {$n == $limit} {return $n}\n"
+           "  return [pong \"${n}+\"]\n"
+           "}\n"
+           "def pong {n} {\n"
+           "  if {$n == $limit} {return $n}\n"
+           "  return [pong2 \"${n}+\"]\n"
+           "}\n"
+           "def pong2 {n} {return [ping $n]}\n"
+           "global result [ping \"\"]\n");
+    test << test::assert(*interp.var("result") == std::string(500, '+'));
+
+    /* return [f ...] in a block, such as if's or try's, calls f while the
+     * block is still there, so errors from f are still caught by try.
+     */
+    interp.add("raise", [](cutlet::interpreter &, const cutlet::list &) {
+      throw std::runtime_error("raised");
+      return cutlet::variable::pointer();
+    });
+    interp("def g {} {raise}\n"
+           "def f {} {\n"
+           "  try {\n"
+           "    return [g]\n"
+           "  } catch e {\n"
+           "    global caught = $e\n"
+           "  }\n"
+           "  return after\n"
+           "}\n"
+           "def h {n} {return $n}\n"
+           "def k {} {\n"
+           "  if {true} {return [h blocked]}\n"
+           "  return after\n"
+           "}\n"
+           "global r1 [f]\n"
+           "global r2 [k]\n");
+    test << test::assert(interp.var("caught") and
+                         static_cast<std::string>(*interp.var("caught"))
+                         .find("raised") != std::string::npos);
+    test << test::assert(*interp.var("r1") == "after");
+    test << test::assert(*interp.var("r2") == "blocked");
+
+    // Any other recursion stops at the limit with an error.
+    interp("def deep {n} {\n"
+           "  if {$n == $limit} {return $n}\n"
+           "  local n [deep \"${n}+\"]\n"
+           "  return $n\n"
+           "}\n");
+    try {
+      interp("deep \"\"\n");
+      test << test::fail << "Stack depth limit not enforced";
+    } catch (cutlet::exception &) {
+    }
+  }
+
+  /*********************
+   * test_frame_labels *
+   *********************/
+
+  void test_frame_labels(test::TestSuite &suite) {
+    auto &test = suite.test("Frame Labels");
+
+    cutlet::interpreter interp;
+    cutlet::cast<cutlet::list>(interp.var("library.path")).push_back(
+      cutlet::var<cutlet::string>("../libs/.libs"));
+    interp.import("stdlib");
+
+    // What the frames look like from inside a condition.
+    std::vector<std::string> labels, traces;
+    interp.add("probe", [&](cutlet::interpreter &interp,
+                            const cutlet::list &args) {
+      labels.push_back(interp.frame(1)->label());
+      std::ostringstream trace;
+      trace << interp.frame(1);
+      traces.push_back(trace.str());
+      if (args.size() and *args[0] == "fail")
+        throw std::runtime_error("probe failed");
+      return args.size() ? args[0] : cutlet::var<cutlet::string>("");
+    });
+
+    interp("global n = \"\"\n"
+           "while {[probe $n] <> \"++\"} {global n = \"${n}+\"}\n");
+    test << test::assert(labels.size() == 3);
+    for (unsigned int index = 0; index < labels.size(); ++index) {
+      test << test::assert(labels[index] == "□ [probe $n] <> \"++\"");
+      test << test::assert(traces[index] == "2: " + labels[index]);
+    }
+
+    /* Errors give where they happened in the script, whether the code was
+     * just compiled or came from the cache.
+     */
+    std::vector<std::string> errors;
+    for (unsigned int count = 0; count < 2; ++count) {
+      try {
+        interp("global m = fail\n"
+               "def check {v} {\n"
+               "  if {[probe $v] == x} {global n = y}\n"
+               "}\n"
+               "if {[probe $m] == x} {global n = y}\n");
+      } catch (std::exception &err) {
+        errors.push_back(err.what());
+      }
+      try {
+        interp("check $m\n");
+      } catch (std::exception &err) {
+        errors.push_back(err.what());
+      }
+    }
+    test << test::assert(errors.size() == 4);
+    for (unsigned int index = 0; index < errors.size(); index += 2) {
+      test << test::assert(errors[index] == "<string>:77: probe failed");
+      test << test::assert(errors[index + 1] == "<string>:39: probe failed");
+    }
+
+    // The conditions' frames are labelled with their own text.
+    test << test::assert(labels.size() == 7);
+    test << test::assert(labels[3] == "□ [probe $m] == x");
+    test << test::assert(labels[4] == "□ [probe $v] == x");
+    test << test::assert(labels[5] == labels[3] and labels[6] == labels[4]);
+  }
+
+  /********************
+   * test_def_layouts *
+   ********************/
+
+  void test_def_layouts(test::TestSuite &suite) {
+    auto &test = suite.test("Function Layouts");
+
+    cutlet::interpreter interp;
+
+    // The names with slots in the frame of the function calling probe.
+    std::vector<std::string> names;
+    interp.add("probe", [&](cutlet::interpreter &interp,
+                            const cutlet::list &) {
+      names.clear();
+      auto layout = interp.frame(1)->layout();
+      if (layout) {
+        for (auto &it: layout->slots) names.push_back(it.first);
+      }
+      std::sort(names.begin(), names.end());
+      return cutlet::variable::pointer();
+    });
+
+    /* Only the names written in the function's code get slots. Names made
+     * up at run time are kept by name, and don't pile up in the layout
+     * from one call to the next.
+     */
+    interp("def set_local {name value} {uplevel \"local $name = $value\"}\n"
+           "def f {n} {\n"
+           "  local x = 1\n"
+           "  local $n = 2\n"
+           "  set_local \"up${n}\" 3\n"
+           "  probe\n"
+           "}\n");
+    const std::vector<std::string> expected{"n", "x"};
+    for (auto name: {"a", "b", "c"}) {
+      interp("f " + std::string(name) + "\n");
+      test << test::assert(names == expected);
+    }
+
+    // Names set at run time are still found by name.
+    interp("def g {n} {\n"
+           "  local $n = 2\n"
+           "  global got = $a\n"
+           "  set_local a 3\n"
+           "  local a = \"${a}+\"\n"
+           "  global got = \"$got $a\"\n"
+           "}\n"
+           "g a\n"
+           "g a\n");
+    test << test::assert(*interp.var("got") == "2 3+");
+  }
+
+  /***********************
+   * test_fused_commands *
+   ***********************/
+
+  void test_fused_commands(test::TestSuite &suite) {
+    auto &test = suite.test("Fused Commands");
+
+    cutlet::interpreter interp;
+    auto code = interp.compile("def f {} {\n"
+                               "  local x = a\n"
+                               "  global y = b\n"
+                               "  $l append $x\n"
+                               "  return $x\n"
+                               "}\n"
+                               "global l = [list]\n"
+                               "global r = [f]\n");
+    (*code)(interp);
+    test << test::assert(*interp.var("r") == "a");
+    test << test::assert(*interp.var("y") == "b");
+    test << test::assert(cutlet::cast<cutlet::list>(interp.var("l")).size()
+                         == 1);
+
+    // Redefining a builtin is seen by the commands using it.
+    interp.add("local", [](cutlet::interpreter &interp,
+                           const cutlet::list &args) {
+      interp.frame(1)->variable(*args[0], args[2]);
+      interp.global("z", args[2]);
+      return cutlet::variable::pointer();
+    });
+    (*code)(interp);
+    test << test::assert(interp.var("z") and *interp.var("z") == "a");
+    test << test::assert(cutlet::cast<cutlet::list>(interp.var("l")).size()
+                         == 1);
+  }
+
+  /* A list that adds an operator by overriding operator(), as native code
+   * did before selectors.
+   */
+  class stack : public cutlet::list {
+  public:
+    virtual cutlet::variable::pointer
+    operator()(cutlet::variable::pointer self, cutlet::interpreter &interp,
+               const cutlet::list &arguments) override {
+      if (arguments.size() == 1 and *arguments[0] == "top") return back();
+      return cutlet::list::operator()(self, interp, arguments);
+    }
+  };
+
+  /******************
+   * test_selectors *
+   ******************/
+
+  void test_selectors(test::TestSuite &suite) {
+    auto &test = suite.test("Selectors");
+
+    test << test::assert(cutlet::selector("append") == cutlet::SEL_APPEND);
+    test << test::assert(cutlet::selector("=") == cutlet::SEL_EQUAL);
+    test << test::assert(cutlet::selector("!=") == cutlet::SEL_NOT_EQUAL);
+
+    // New names are interned once, looking them up doesn't intern them.
+    cutlet::list unknown{cutlet::var<cutlet::string>("no such operator")};
+    test << test::assert(cutlet::selector(unknown) == cutlet::SEL_NONE);
+    auto id = cutlet::selector("a new operator");
+    test << test::assert(id > cutlet::SEL_XOR);
+    test << test::assert(cutlet::selector("a new operator") == id);
+
+    // Operators are the same whether they were known when compiled or not.
+    cutlet::interpreter interp;
+    interp("global l = [list a b]\n"
+           "global op = size\n"
+           "global n1 [$l size]\n"
+           "global n2 [$l $op]\n"
+           "global n3 [\"abc\" length]\n");
+    test << test::assert(*interp.var("n1") == "2");
+    test << test::assert(*interp.var("n2") == "2");
+    test << test::assert(*interp.var("n3") == "3");
+
+    auto l = interp.var("l");
+    cutlet::list args{cutlet::var<cutlet::string>("append"),
+                      cutlet::var<cutlet::string>("c")};
+    l->method(l, interp, cutlet::SEL_APPEND, args);
+    test << test::assert(cutlet::cast<cutlet::list>(l).size() == 3);
+
+    // Subclasses can still add operators by overriding operator().
+    interp.global("s", std::make_shared<stack>());
+    interp("$s append x y\n"
+           "global t [$s top]\n"
+           "global n4 [$s size]\n");
+    test << test::assert(*interp.var("t") == "y");
+    test << test::assert(*interp.var("n4") == "2");
+    try {
+      interp("$s bottom\n");
+      test << test::fail << "Unknown operator not detected";
+    } catch (std::exception &err) {
+      test << test::assert(std::string(err.what()).find(
+                             "Unknown operator bottom") != std::string::npos);
+    }
+  }
+
+  /**************
+   * test_atoms *
+   **************/
+
+  void test_atoms(test::TestSuite &suite) {
+    auto &test = suite.test("Atoms");
+
+    // Finding a name doesn't intern it.
+    test << test::assert(cutlet::atom::find("an atom not seen").empty());
+
+    cutlet::atom first("an atom"), second(std::string("an atom"));
+    test << test::assert(first == second);
+    test << test::assert(&first.str() == &second.str());
+    test << test::assert(cutlet::atom::find("an atom") == first);
+    test << test::assert(first != cutlet::atom("another atom"));
+    test << test::assert(cutlet::atom().str().empty());
+
+    // Variables keyed by atoms are found by the names they were set with.
+    cutlet::interpreter interp;
+    interp("global g = 1\n"
+           "list a b c\n"
+           "global h = $g\n");
+    test << test::assert(*interp.var("h") == "1");
+    test << test::assert(interp.environment()->has_variable("g"));
+    test << test::assert(not interp.environment()->has_variable("nope"));
+
+    // Components are still given sorted by name.
+    auto &components = interp.environment()->components();
+    test << test::assert(components.count("def") == 1);
+    test << test::assert(std::is_sorted(
+      components.begin(), components.end(),
+      [](auto &a, auto &b) { return a.first < b.first; }));
+
+    /* Once the table is full new names get atoms of their own, which are
+     * still equal to other atoms of the same name.
+     */
+    for (size_t count = 0; cutlet::atom::interned() < cutlet::atom::capacity;
+         ++count)
+      cutlet::atom("filler " + std::to_string(count));
+    cutlet::atom past("past the table"), again("past the table");
+    test << test::assert(cutlet::atom::interned() == cutlet::atom::capacity);
+    test << test::assert(past == again and &past.str() != &again.str());
+    test << test::assert(past != cutlet::atom("also past the table"));
+    test << test::assert(past != first);
+    test << test::assert(cutlet::atom::find("past the table") == past);
+    test << test::assert(cutlet::atom::find("an atom") == first);
+
+    interp("global \"past${g}\" = 2\n"
+           "global i = $past1\n");
+    test << test::assert(*interp.var("i") == "2");
+  }
 }
 
 /******************************************************************************
@@ -68,6 +984,24 @@ int main(int argc, char *argv[]) {
   test::TestSuite suite("Cutlet API Tests");
 
   test_utf8(suite);
+  test_tokenizer(suite);
+  test_token_patterns(suite);
+  test_parallel_parse(suite);
+  test_call_cache(suite);
+  test_shared_cache(suite);
+  test_compile(suite);
+  test_compile_file(suite);
+  test_compile_cache(suite);
+  test_arguments(suite);
+  test_optimize(suite);
+  test_emit_cpp(suite);
+  test_bytecode(suite);
+  test_tail_calls(suite);
+  test_frame_labels(suite);
+  test_def_layouts(suite);
+  test_fused_commands(suite);
+  test_selectors(suite);
+  test_atoms(suite);
 
   std::cout << suite << std::flush;
   return (suite.passed() ? 0 : 1);
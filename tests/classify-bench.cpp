@@ -0,0 +1,172 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Character classification microbenchmark.
+ *
+ * Measures the cost per character of deciding whether a character is white
+ * space or an end of line, the question the tokenizer asks of every
+ * character it sees. The compare column is the old approach of comparing
+ * the character against each string in turn, the table column is
+ * is_space()/is_eol() and the once column decodes the character once and
+ * does a single table lookup.
+ *
+ *   make classify-bench && ./classify-bench ¿megabytes?
+ */
+
+#include <cutlet>
+#include "utilities.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace {
+
+  /********************
+   * compare_is_space *
+   ********************/
+
+  bool compare_is_space(const std::string &value) {
+    if (value == "\u0020") return true;
+    if (value == "\u0009") return true;
+    if (value == "\u00a0") return true;
+    if (value == "\u2000") return true;
+    if (value == "\u2001") return true;
+    if (value == "\u2002") return true;
+    if (value == "\u2003") return true;
+    if (value == "\u2004") return true;
+    if (value == "\u2005") return true;
+    if (value == "\u2006") return true;
+    if (value == "\u2007") return true;
+    if (value == "\u2008") return true;
+    if (value == "\u2009") return true;
+    if (value == "\u200a") return true;
+    if (value == "\u202f") return true;
+    if (value == "\u205f") return true;
+    if (value == "\u3000") return true;
+    return false;
+  }
+
+  /******************
+   * compare_is_eol *
+   ******************/
+
+  bool compare_is_eol(const std::string &value) {
+    if (value == "\u000a")       return true;
+    if (value == "\u000b")       return true;
+    if (value == "\u000c")       return true;
+    if (value == "\u000d\u000a") return true;
+    if (value == "\u000d")       return true;
+    if (value == "\u0085")       return true;
+    if (value == "\u2028")       return true;
+    if (value == "\u2029")       return true;
+    return false;
+  }
+
+  /************
+   * generate *
+   ************/
+
+  /** Mostly ASCII script text with some accented, CJK and space
+   * characters mixed in.
+   */
+  std::string generate(size_t size) {
+    std::string result;
+    result.reserve(size + 64);
+    while (result.length() < size) {
+      result += "config.set na\u00efve.key \"value\u3000with\u00a0spaces\" "
+                "[config.get \u65e5\u672c\u8a9e 42] {a b {c d}}\n";
+    }
+    return result;
+  }
+
+  /********
+   * time *
+   ********/
+
+  /** Run the classifier over every character of text, returning the
+   * nanoseconds taken per character.
+   */
+  template <typename Fn>
+  double time(const std::string &text, size_t &count, Fn classify) {
+    unsigned int hits = 0;
+    count = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    cutlet::utf8::iterator it(text);
+    for (; it != it.end(); ++it, ++count) {
+      if (classify(it)) ++hits;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Make sure the work isn't optimized away.
+    if (hits == 0) std::cerr << "no hits?" << std::endl;
+
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+      static_cast<double>(count);
+  }
+}
+
+/******************************************************************************
+ * Let's get started.
+ */
+
+int main(int argc, char *argv[]) {
+  size_t mb = (argc > 1 ? std::stoul(argv[1]) : 16);
+  const std::string text = generate(mb * 1024 * 1024);
+  size_t count;
+
+  const double empty = time(text, count, [](cutlet::utf8::iterator &it) {
+    return it.length() != 0;
+  });
+
+  const double compare = time(text, count, [](cutlet::utf8::iterator &it) {
+    return compare_is_space(*it) or compare_is_eol(*it);
+  });
+
+  const double table = time(text, count, [](cutlet::utf8::iterator &it) {
+    return is_space(it.view()) or is_eol(it.view());
+  });
+
+  const double once = time(text, count, [](cutlet::utf8::iterator &it) {
+    return (classify_utf8(it.view()) & (CC_SPACE | CC_EOL)) != 0;
+  });
+
+  std::cout << count << " characters, ns per character"
+            << " (iteration alone " << std::fixed << std::setprecision(2)
+            << empty << ")" << std::endl;
+  std::cout << std::setw(12) << "compare"
+            << std::setw(12) << "table"
+            << std::setw(12) << "once" << std::endl;
+  std::cout << std::setw(12) << compare - empty
+            << std::setw(12) << table - empty
+            << std::setw(12) << once - empty << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,227 @@
+/*                                                                  -*- c++ -*-
+ * Copyright © 2018-2021 Ron R Wills <ron@digitalcombine.ca>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from this
+ *    software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Tokenizer scaling benchmark.
+ *
+ * Generates large configuration style scripts and times how long the
+ * interpreter takes to tokenize, compile and run them. The string column is a
+ * script of many lines given as one string, the stream column is a single
+ * large block read through an input stream like a script file. The time per
+ * megabyte should stay flat as the script grows if the tokenizer scales
+ * linearly.
+ *
+ * Given a script with -f, it's compiled repeatedly instead, reporting the
+ * time per compile and the heap the compiled program holds on to. With -j a
+ * generated script is compiled using 1, 2, 4 and 8 parse threads.
+ *
+ *   make tokenizer-bench && ./tokenizer-bench ¿max_megabytes?
+ *   make tokenizer-bench && ./tokenizer-bench -f rules.cutlet ¿count?
+ *   make tokenizer-bench && ./tokenizer-bench -j ¿megabytes?
+ */
+
+#include <cutlet>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <malloc.h>
+
+namespace {
+
+  /********
+   * _nop *
+   ********/
+
+  cutlet::variable::pointer _nop(cutlet::interpreter &interp,
+                                 const cutlet::list &arguments) {
+    (void)interp;
+    (void)arguments;
+    return nullptr;
+  }
+
+  /************
+   * generate *
+   ************/
+
+  /** Creates a script of roughly the given size made up of config lines.
+   * @param size The size of the script in bytes.
+   * @param block Wrap the whole script in a single block.
+   */
+  std::string generate(size_t size, bool block) {
+    std::string result;
+    result.reserve(size + 64);
+
+    if (block) result += "config.block {\n";
+    for (unsigned int line = 0; result.length() < size; ++line) {
+      result += "config.set key." + std::to_string(line) +
+                " \"value $line\" [config.get default " +
+                std::to_string(line) + "] {a b {c d}}\n";
+    }
+    if (block) result += "}\n";
+
+    return result;
+  }
+
+  /*******
+   * run *
+   *******/
+
+  /** Compile and run the script returning the number of seconds it took.
+   * @param code The script source.
+   * @param stream Feed the script through an input stream like a file.
+   */
+  double run(const std::string &code, bool stream) {
+    cutlet::interpreter interp;
+    interp.add("config.set", _nop);
+    interp.add("config.get", _nop);
+    interp.add("config.block", _nop);
+    interp.global("line", cutlet::var<cutlet::string>("0"));
+
+    std::istringstream in(code);
+
+    auto start = std::chrono::steady_clock::now();
+    if (stream)
+      interp(in, "bench");
+    else
+      interp(code);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+  }
+
+  /****************
+   * compile_file *
+   ****************/
+
+  /** Compile a script count times without running it.
+   * @param filename The script to compile.
+   * @param count The number of times to compile it.
+   * @return False if the script couldn't be read.
+   */
+  bool compile_file(const std::string &filename, unsigned int count) {
+    std::ifstream in(filename);
+    if (not in) {
+      std::cerr << "Unable to read " << filename << std::endl;
+      return false;
+    }
+    std::stringstream code;
+    code << in.rdbuf();
+
+    cutlet::interpreter interp;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int pass = 1; pass < count; ++pass)
+      interp.compile(code.str(), filename);
+    auto end = std::chrono::steady_clock::now();
+
+    // Measure what the last program keeps once the source buffer is gone.
+    const auto before = mallinfo2().uordblks;
+    auto program = interp.compile(code.str(), filename);
+    const auto after = mallinfo2().uordblks;
+
+    std::cout << filename << ": " << code.str().length() << " bytes\n"
+              << std::fixed << std::setprecision(3)
+              << "  compile " << std::chrono::duration<double, std::milli>(
+                   end - start).count() / std::max(count - 1, 1u)
+              << " ms\n"
+              << "  program " << (after - before) << " bytes" << std::endl;
+    return true;
+  }
+
+  /*****************
+   * parse_threads *
+   *****************/
+
+  /** Compile a generated script with different numbers of parse threads.
+   * @param megabytes The size of the script.
+   */
+  void parse_threads(size_t megabytes) {
+    const std::string code = generate(megabytes * 1024 * 1024, false);
+
+    std::cout << std::thread::hardware_concurrency() << " CPUs, "
+              << megabytes << "MB script\n"
+              << std::setw(10) << "threads" << std::setw(14) << "compile (s)"
+              << std::endl;
+
+    for (unsigned int threads: {1, 2, 4, 8}) {
+      cutlet::interpreter interp;
+      interp.parse_threads(threads);
+
+      auto start = std::chrono::steady_clock::now();
+      interp.compile(code, "bench");
+      auto end = std::chrono::steady_clock::now();
+
+      std::cout << std::setw(10) << threads << std::fixed
+                << std::setprecision(4) << std::setw(14)
+                << std::chrono::duration<double>(end - start).count()
+                << std::endl;
+    }
+  }
+}
+
+/******************************************************************************
+ * Let's get started.
+ */
+
+int main(int argc, char *argv[]) {
+  if (argc > 2 and std::string(argv[1]) == "-f")
+    return (compile_file(argv[2],
+                         (argc > 3 ? std::stoul(argv[3]) : 50)) ? 0 : 1);
+
+  if (argc > 1 and std::string(argv[1]) == "-j") {
+    parse_threads(argc > 2 ? std::stoul(argv[2]) : 4);
+    return 0;
+  }
+
+  size_t max_mb = (argc > 1 ? std::stoul(argv[1]) : 8);
+
+  std::cout << std::setw(10) << "size (KB)"
+            << std::setw(14) << "string (s)"
+            << std::setw(14) << "s/MB"
+            << std::setw(14) << "stream (s)"
+            << std::setw(14) << "s/MB" << std::endl;
+
+  for (size_t kb = 128; kb <= max_mb * 1024; kb *= 2) {
+    const double mb = static_cast<double>(kb) / 1024.0;
+    const double string = run(generate(kb * 1024, false), false);
+    const double stream = run(generate(kb * 1024, true), true);
+
+    std::cout << std::setw(10) << kb << std::fixed << std::setprecision(4)
+              << std::setw(14) << string
+              << std::setw(14) << string / mb
+              << std::setw(14) << stream
+              << std::setw(14) << stream / mb << std::endl;
+  }
+
+  return 0;
+}